@@ -0,0 +1,25 @@
+# Writes OUTPUT, a header holding every file in SOURCES ("|"-separated) as a
+# raw string literal, keyed by file name. Run with cmake -P at build time.
+string(REPLACE "|" ";" SOURCES "${SOURCES}")
+
+set(content "// Generated by cmake/embed_shaders.cmake. Do not edit.\n")
+string(APPEND content "#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n\n")
+string(APPEND content "#include <string_view>\n\n")
+string(APPEND content "struct EmbeddedShader {\n  std::string_view name;\n")
+string(APPEND content "  std::string_view source;\n};\n\n")
+string(APPEND content "inline constexpr EmbeddedShader kEmbeddedShaders[] = {\n")
+foreach(source IN LISTS SOURCES)
+  get_filename_component(name "${source}" NAME)
+  file(READ "${source}" text)
+  string(APPEND content "    {\"${name}\", R\"embedded_glsl(${text})embedded_glsl\"},\n")
+endforeach()
+string(APPEND content "};\n\n#endif\n")
+
+# Leave the header untouched when nothing changed so dependents don't rebuild.
+if(EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" previous)
+  if(previous STREQUAL content)
+    return()
+  endif()
+endif()
+file(WRITE "${OUTPUT}" "${content}")
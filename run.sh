@@ -1,7 +1,5 @@
 #!/bin/bash
 
-# --- Approach 1: Using the '&' operator (with argument and process control) ---
-
 # Define the path to your executable
 executable="./build/window"
 
@@ -10,7 +8,7 @@ audio_file="$1"
 
 # Check if an argument was provided
 if [ -z "$audio_file" ]; then
-  echo "Usage: $0 <path_to_audio_file.wav>"
+  echo "Usage: $0 <path_to_audio_file.wav> [window options]"
   exit 1
 fi
 
@@ -26,32 +24,9 @@ if [ ! -x "$executable" ]; then
   exit 1
 fi
 
-# Function to stop the audio playback
-stop_audio() {
-  echo "Stopping audio..."
-  # Use the stored PID to kill the background audio process gracefully
-  if [ -n "$audio_pid" ] && ps -p "$audio_pid" > /dev/null; then
-    kill "$audio_pid"
-  fi
-}
-
-# Trap SIGINT (Ctrl+C) and SIGTERM signals and call the stop_audio function
-trap stop_audio SIGINT SIGTERM
-
-# Play the audio file in the background using afplay (for macOS)
-# Replace 'aplay' with your preferred command-line audio player if not on macOS
-afplay "$audio_file" &
-
-# Store the PID of the background audio process
-audio_pid=$!
-
-# Run your executable
-"$executable"
-
-# Wait for the executable to finish (it's the foreground process)
-# The trap will handle stopping audio if the script is interrupted
-
-# After the executable finishes, explicitly stop the audio just in case
-stop_audio
+# The executable plays the audio itself (see --sink) and drives the visuals
+# from the playback clock, so no separate player process is needed.
+shift
+"$executable" "$@" "$audio_file"
 
-echo "Executable finished."
\ No newline at end of file
+echo "Executable finished."
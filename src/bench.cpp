@@ -0,0 +1,526 @@
+// Microbenchmarks for the analysis and geometry hot paths. Needs no GL
+// context, so it runs on headless CI machines.
+//
+//   bench [options]
+//     --filter <text>     only run benchmarks whose name contains <text>
+//     --min-time-ms <n>   keep repeating each benchmark for at least this long
+//     --dir <dir>         where the synthetic WAVs are written (default /tmp)
+//     --keep-wavs         leave the synthetic WAVs behind
+//
+// Prints one JSON object per benchmark per line (JSON Lines) to stdout:
+//   {"name": ..., "params": ..., "iterations": ..., "elements": ...,
+//    "unit": ..., "ns_per_element": ..., "elements_per_s": ...}
+// `elements` is the work one iteration does in `unit`s (samples, points, ...);
+// the timings are the median over iterations. Progress goes to stderr.
+// Only speed is measured here; kernel_check (ctest) checks each kernel's
+// results against its scalar reference.
+#include "speaker_points/displacement_engine.hpp"
+#include "speaker_points/k_weighting.hpp"
+#include "speaker_points/loudness_pyramid.hpp"
+#include "speaker_points/pcm_sum_squares.hpp"
+#include "speaker_points/speaker_dbs.hpp"
+#include "speaker_points/speaker_layout.hpp"
+#include "speaker_points/speaker_points.hpp"
+#include "speaker_points/sum_squares.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Same analysis settings as Room.
+constexpr float kEpochTime = 0.03f;
+const std::vector<float> kBandSplits_hz = {250.f, 4000.f};
+
+struct BenchOptions {
+  std::string filter;
+  double minTime_ms = 200.0;
+  std::string dir = "/tmp";
+  bool keepWavs = false;
+};
+
+BenchOptions parseBenchOptions(int argc, char **argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--filter" && hasValue) {
+      options.filter = argv[++i];
+    } else if (arg == "--min-time-ms" && hasValue) {
+      options.minTime_ms = std::max(0.0, std::atof(argv[++i]));
+    } else if (arg == "--dir" && hasValue) {
+      options.dir = argv[++i];
+    } else if (arg == "--keep-wavs") {
+      options.keepWavs = true;
+    } else {
+      std::cerr << "Ignoring unknown option " << arg << "\n";
+    }
+  }
+  return options;
+}
+
+// Keeps the compiler from discarding a result it can see is unused.
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Runner {
+public:
+  explicit Runner(const BenchOptions &options) : options(options) {}
+
+  // Times `body` (one iteration, `elements` units of work) after one warm-up
+  // call. `setup`, if given, runs untimed before every call.
+  void run(const std::string &name, const std::string &params,
+           double elements, const char *unit,
+           const std::function<void()> &body,
+           const std::function<void()> &setup = nullptr) {
+    if (!options.filter.empty() &&
+        name.find(options.filter) == std::string::npos) {
+      return;
+    }
+    std::cerr << name << " " << params << "\n";
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> times_ns;
+    double total_ms = 0.0;
+    for (int i = -1; i < 1 || total_ms < options.minTime_ms; ++i) {
+      if (setup) {
+        setup();
+      }
+      const auto start = Clock::now();
+      body();
+      const std::chrono::duration<double, std::nano> elapsed =
+          Clock::now() - start;
+      if (i >= 0) {
+        times_ns.push_back(elapsed.count());
+      }
+      total_ms += elapsed.count() / 1e6;
+    }
+    std::nth_element(times_ns.begin(), times_ns.begin() + times_ns.size() / 2,
+                     times_ns.end());
+    const double median_ns = times_ns[times_ns.size() / 2];
+    std::printf("{\"name\": \"%s\", \"params\": \"%s\", \"iterations\": %zu, "
+                "\"elements\": %.0f, \"unit\": \"%s\", "
+                "\"ns_per_element\": %.4f, \"elements_per_s\": %.6g}\n",
+                name.c_str(), params.c_str(), times_ns.size(), elements, unit,
+                median_ns / elements, elements * 1e9 / median_ns);
+    std::fflush(stdout);
+  }
+
+private:
+  const BenchOptions &options;
+};
+
+// A 16-bit PCM WAV of noise under a per-channel sine, so every channel has a
+// different, non-silent level.
+struct SyntheticWav {
+  int numChannels;
+  int sampleRate;
+  float length_s;
+
+  std::string params() const {
+    return std::to_string(numChannels) + "ch " + std::to_string(sampleRate) +
+           "Hz " + std::to_string(static_cast<int>(length_s)) + "s";
+  }
+  size_t numFrames() const {
+    return static_cast<size_t>(length_s * sampleRate);
+  }
+  std::string path(const std::string &dir) const {
+    return dir + "/bench_" + std::to_string(numChannels) + "ch_" +
+           std::to_string(sampleRate) + "_" +
+           std::to_string(static_cast<int>(length_s)) + "s.wav";
+  }
+
+  bool write(const std::string &file) const {
+    std::FILE *out = std::fopen(file.c_str(), "wb");
+    if (out == nullptr) {
+      std::cerr << "ERROR::BENCH::WAV_NOT_WRITTEN: " << file << std::endl;
+      return false;
+    }
+    const uint32_t blockAlign = numChannels * 2;
+    const uint32_t dataSize = static_cast<uint32_t>(numFrames() * blockAlign);
+    auto u32 = [out](uint32_t v) { std::fwrite(&v, 4, 1, out); };
+    auto u16 = [out](uint16_t v) { std::fwrite(&v, 2, 1, out); };
+    std::fwrite("RIFF", 1, 4, out);
+    u32(36 + dataSize);
+    std::fwrite("WAVEfmt ", 1, 8, out);
+    u32(16);
+    u16(1); // PCM
+    u16(numChannels);
+    u32(sampleRate);
+    u32(sampleRate * blockAlign);
+    u16(blockAlign);
+    u16(16);
+    std::fwrite("data", 1, 4, out);
+    u32(dataSize);
+
+    std::minstd_rand rng(1234);
+    std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+    std::vector<int16_t> frames(4096 * numChannels);
+    for (size_t f = 0; f < numFrames(); f += 4096) {
+      const size_t count = std::min<size_t>(4096, numFrames() - f);
+      for (size_t i = 0; i < count; ++i) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+          const double t = static_cast<double>(f + i) / sampleRate;
+          const float s = 0.5f * static_cast<float>(std::sin(
+                                     2 * M_PI * (110.0 + 55.0 * ch) * t)) +
+                          noise(rng);
+          frames[i * numChannels + ch] = static_cast<int16_t>(s * 32767.f);
+        }
+      }
+      std::fwrite(frames.data(), sizeof(int16_t), count * numChannels, out);
+    }
+    return std::fclose(out) == 0;
+  }
+};
+
+void benchLoudness(Runner &runner, const BenchOptions &options) {
+  const std::vector<SyntheticWav> wavs = {
+      {2, 44100, 30.f}, {2, 48000, 120.f}, {2, 96000, 30.f},
+      {6, 48000, 30.f}, {12, 48000, 30.f}, {24, 48000, 10.f},
+  };
+  for (const SyntheticWav &wav : wavs) {
+    const std::string path = wav.path(options.dir);
+    if (!wav.write(path)) {
+      continue;
+    }
+    const std::string sidecar = EnvelopeCache::sidecarPath(path);
+    auto removeSidecar = [&sidecar]() { std::remove(sidecar.c_str()); };
+    const double numSamples =
+        static_cast<double>(wav.numFrames()) * wav.numChannels;
+
+    // Header parse plus a sidecar lookup that misses.
+    runner.run("loudness/construct", wav.params(), 1, "constructions",
+               [&]() {
+                 LoudnessGenerator generator(path, kEpochTime);
+                 doNotOptimize(generator.getLength_s());
+               },
+               removeSidecar);
+
+    // Decode and analyse the whole track, epoch by epoch, as the producer
+    // thread does. The sidecar is written at the end, as on a real first run.
+    runner.run("loudness/next_epoch", wav.params(), numSamples, "samples",
+               [&]() {
+                 LoudnessGenerator generator(path, kEpochTime);
+                 for (LoudnessEpoch e = generator.nextLoudnessEpoch();
+                      e.timeStamp >= 0; e = generator.nextLoudnessEpoch()) {
+                   doNotOptimize(e.speakerDbs.data());
+                 }
+               },
+               removeSidecar);
+
+    runner.run("loudness/next_epoch_bands", wav.params(), numSamples,
+               "samples", [&]() {
+                 LoudnessGenerator generator(path, kEpochTime, kBandSplits_hz);
+                 for (LoudnessEpoch e = generator.nextLoudnessEpoch();
+                      e.timeStamp >= 0; e = generator.nextLoudnessEpoch()) {
+                   doNotOptimize(e.bandDbs.data());
+                 }
+               },
+               removeSidecar);
+
+    runner.run("loudness/next_epoch_lufs", wav.params(), numSamples,
+               "samples", [&]() {
+                 LoudnessGenerator generator(path, kEpochTime, {},
+                                             LoudnessMode::kLufs);
+                 for (LoudnessEpoch e = generator.nextLoudnessEpoch();
+                      e.timeStamp >= 0; e = generator.nextLoudnessEpoch()) {
+                   doNotOptimize(e.momentaryLufs.data());
+                 }
+                 doNotOptimize(generator.getIntegratedLufs());
+               });
+
+    runner.run("loudness/analyze_range", wav.params(), numSamples, "samples",
+               [&]() {
+                 LoudnessGenerator generator(path, kEpochTime);
+                 const LoudnessEnvelope envelope = generator.analyzeRange();
+                 doNotOptimize(envelope.records.data());
+               },
+               removeSidecar);
+
+    runner.run("loudness/analyze_range_bands", wav.params(), numSamples,
+               "samples",
+               [&]() {
+                 LoudnessGenerator generator(path, kEpochTime, kBandSplits_hz);
+                 const LoudnessEnvelope envelope = generator.analyzeRange();
+                 doNotOptimize(envelope.records.data());
+               },
+               removeSidecar);
+
+    runner.run("loudness/pyramid_build", wav.params(), numSamples, "samples",
+               [&]() {
+                 LoudnessPyramid pyramid;
+                 pyramid.build(path);
+                 doNotOptimize(pyramid.getNumLevels());
+               });
+    {
+      LoudnessPyramid pyramid;
+      pyramid.build(path);
+      std::minstd_rand rng(5);
+      std::uniform_real_distribution<float> when(0.f, wav.length_s);
+      std::vector<float> dbs;
+      runner.run("loudness/pyramid_range_db", wav.params() + " x 1000", 1000,
+                 "queries", [&]() {
+                   for (int i = 0; i < 1000; ++i) {
+                     const float a = when(rng), b = when(rng);
+                     pyramid.rangeDb(std::min(a, b), std::max(a, b), dbs);
+                     doNotOptimize(dbs.data());
+                   }
+                 });
+      // The whole track at the room's epoch length, as a re-analysis would.
+      runner.run("loudness/pyramid_envelope", wav.params(),
+                 std::ceil(wav.length_s / kEpochTime), "epochs", [&]() {
+                   doNotOptimize(
+                       pyramid.envelope(0.f, wav.length_s, kEpochTime)
+                           .records.data());
+                 });
+    }
+
+    // Every epoch served from the mapped sidecar.
+    {
+      LoudnessGenerator(path, kEpochTime).analyzeRange();
+    }
+    runner.run("loudness/construct_cached", wav.params(), 1, "constructions",
+               [&]() {
+                 LoudnessGenerator generator(path, kEpochTime);
+                 doNotOptimize(generator.getLength_s());
+               });
+    runner.run("loudness/next_epoch_cached", wav.params(), numSamples,
+               "samples", [&]() {
+                 LoudnessGenerator generator(path, kEpochTime);
+                 for (LoudnessEpoch e = generator.nextLoudnessEpoch();
+                      e.timeStamp >= 0; e = generator.nextLoudnessEpoch()) {
+                   doNotOptimize(e.speakerDbs.data());
+                 }
+               });
+
+    removeSidecar();
+    if (!options.keepWavs) {
+      std::remove(path.c_str());
+    }
+  }
+}
+
+void benchSumSquares(Runner &runner) {
+  const size_t n = 1440; // One 30 ms epoch at 48 kHz.
+  std::vector<float> x(n);
+  std::minstd_rand rng(7);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (float &v : x) {
+    v = dist(rng);
+  }
+  const SumSquaresKernel kernels[] = {{"scalar", sumSquaresScalar},
+                                      sumSquaresKernel()};
+  for (const SumSquaresKernel &kernel : kernels) {
+    runner.run(std::string("analysis/sum_squares_") + kernel.name,
+               std::to_string(n) + " samples x 1000", n * 1000.0, "samples",
+               [&]() {
+                 for (int i = 0; i < 1000; ++i) {
+                   doNotOptimize(kernel.fn(x.data(), n));
+                 }
+               });
+  }
+}
+
+// Interleaved stereo epochs straight from PCM bytes, as readSumSquares()
+// sees them; compare with sum_squares_* times two channels.
+void benchPcmSumSquares(Runner &runner) {
+  const size_t numFrames = 1440;
+  const int numChannels = 2;
+  std::minstd_rand rng(11);
+  for (int bits : {16, 24}) {
+    const size_t stride = numChannels * bits / 8;
+    std::vector<uint8_t> bytes(numFrames * stride);
+    for (uint8_t &b : bytes) {
+      b = static_cast<uint8_t>(rng());
+    }
+    const PcmSumSquaresKernel kernels[] = {
+        {"scalar", bits == 16 ? pcmSumSquaresInt16Scalar
+                              : pcmSumSquaresInt24Scalar},
+        bits == 16 ? pcmInt16Kernel() : pcmInt24Kernel()};
+    for (const PcmSumSquaresKernel &kernel : kernels) {
+      runner.run(std::string("analysis/pcm") + std::to_string(bits) +
+                     "_sum_squares_" + kernel.name,
+                 std::to_string(numFrames) + " stereo frames x 1000",
+                 numFrames * numChannels * 1000.0, "samples", [&]() {
+                   for (int i = 0; i < 1000; ++i) {
+                     int64_t sums[numChannels] = {};
+                     kernel.fn(bytes.data(), numFrames, numChannels, stride,
+                               sums);
+                     doNotOptimize(sums);
+                   }
+                 });
+    }
+  }
+
+  const size_t stride = numChannels * 4;
+  std::vector<uint8_t> bytes(numFrames * stride);
+  for (uint8_t &b : bytes) {
+    b = static_cast<uint8_t>(rng());
+  }
+  const PcmSumSquaresInt32Kernel kernels[] = {
+      {"scalar", pcmSumSquaresInt32Scalar}, pcmInt32Kernel()};
+  for (const PcmSumSquaresInt32Kernel &kernel : kernels) {
+    runner.run(std::string("analysis/pcm32_sum_squares_") + kernel.name,
+               std::to_string(numFrames) + " stereo frames x 1000",
+               numFrames * numChannels * 1000.0, "samples", [&]() {
+                 for (int i = 0; i < 1000; ++i) {
+                   double sums[numChannels] = {};
+                   kernel.fn(bytes.data(), numFrames, numChannels, stride,
+                             sums);
+                   doNotOptimize(sums);
+                 }
+               });
+  }
+}
+
+// K-weighting alone, on frames already decoded, for 16 channels: the
+// real-time budget is 48000 frames per second.
+void benchKWeighting(Runner &runner) {
+  const size_t numFrames = 1440;
+  const int numChannels = 16;
+  std::vector<float> frames(numFrames * numChannels);
+  std::minstd_rand rng(13);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (float &v : frames) {
+    v = dist(rng);
+  }
+  const KWeightCoeffs coeffs = KWeightCoeffs::forSampleRate(48000.f);
+  const KWeightKernel kernels[] = {{"scalar", kWeightScalar}, kWeightKernel()};
+  for (const KWeightKernel &kernel : kernels) {
+    std::vector<double> state(4 * numChannels), sums(numChannels);
+    runner.run(std::string("analysis/k_weighting_") + kernel.name,
+               std::to_string(numFrames) + " frames x 16 channels x 100",
+               numFrames * numChannels * 100.0, "samples", [&]() {
+                 for (int i = 0; i < 100; ++i) {
+                   kernel.fn(frames.data(), numFrames, numChannels,
+                             numChannels, coeffs, state.data(), sums.data());
+                 }
+                 doNotOptimize(sums.data());
+               });
+  }
+}
+
+void benchGeometry(Runner &runner) {
+  for (int numPoints : {512, 2048, 32768, 524288}) {
+    runner.run("geometry/fibonacci_sphere", std::to_string(numPoints),
+               numPoints, "points", [numPoints]() {
+                 doNotOptimize(generateFibonacciSpherePoints(numPoints).data());
+               });
+  }
+  const size_t lodPoints = generateFibonacciSphereLods(512, 524288).points.size();
+  runner.run("geometry/fibonacci_sphere_lods", "512..524288", lodPoints,
+             "points", []() {
+               doNotOptimize(
+                   generateFibonacciSphereLods(512, 524288).points.data());
+             });
+
+  const size_t numAngles = 1 << 16;
+  std::vector<float> thetas(numAngles), phis(numAngles);
+  for (size_t i = 0; i < numAngles; ++i) {
+    thetas[i] = static_cast<float>(M_PI * i / numAngles);
+    phis[i] = static_cast<float>(2 * M_PI * ((i * 40503u) % numAngles) /
+                                 numAngles);
+  }
+  std::vector<glm::vec3> cartesian(numAngles);
+  runner.run("geometry/spherical_to_cartesian", std::to_string(numAngles),
+             numAngles, "points", [&]() {
+               for (size_t i = 0; i < numAngles; ++i) {
+                 cartesian[i] = sphericalToCartesian(1.f, thetas[i], phis[i]);
+               }
+               doNotOptimize(cartesian.data());
+             });
+}
+
+// CPU versions of the room.vs math.
+void benchShaderMath(Runner &runner) {
+  const size_t numArgs = 1 << 16;
+  std::vector<float> args(numArgs);
+  for (size_t i = 0; i < numArgs; ++i) {
+    args[i] = 64.f * i / numArgs;
+  }
+  runner.run("shader/sinc", std::to_string(numArgs), numArgs, "calls", [&]() {
+    float sum = 0.f;
+    for (float x : args) {
+      sum += shaderSinc(x);
+    }
+    doNotOptimize(sum);
+  });
+
+  FrameUniforms frame{};
+  frame.baseSpatialFrequency = 10.f;
+  frame.amplitudeFrequencyScale = 0.5f;
+  frame.maxOverallDisplacement = 0.05f;
+  for (const char *layoutName : {"stereo", "5.1", "22.2"}) {
+    const std::vector<glm::vec3> spkrPos =
+        SpeakerLayout::findPreset(layoutName)->getPositions();
+    const std::vector<glm::vec4> levels(spkrPos.size(),
+                                        glm::vec4(0.5f, 0.3f, 0.2f, 0.4f));
+    for (int numPoints : {2048, 131072}) {
+      const std::vector<glm::vec3> points =
+          generateFibonacciSpherePoints(numPoints);
+      const std::string params = std::to_string(numPoints) + " points, " +
+                                 std::to_string(spkrPos.size()) + " speakers";
+      const double elements = static_cast<double>(numPoints) * spkrPos.size();
+
+      runner.run("shader/speaker_angles", params, elements, "point-speakers",
+                 [&]() {
+                   doNotOptimize(
+                       speakerAngles(points, spkrPos, spkrPos.size()).data());
+                 });
+
+      std::vector<float> out(4 * points.size());
+      DisplacementEngine single(points, spkrPos, 1);
+      const DisplaceKernel kernels[] = {{"scalar", displaceScalar},
+                                        displaceKernel()};
+      for (const DisplaceKernel &kernel : kernels) {
+        runner.run(std::string("shader/displace_") + kernel.name, params,
+                   elements, "point-speakers", [&]() {
+                     single.displace(frame, levels, out.data(), kernel.fn);
+                     doNotOptimize(out.data());
+                   });
+      }
+      DisplacementEngine pooled(points, spkrPos);
+      runner.run("shader/displace_pooled",
+                 params + ", " + std::to_string(pooled.getNumThreads()) +
+                     " threads",
+                 elements, "point-speakers", [&]() {
+                   pooled.displace(frame, levels, out.data());
+                   doNotOptimize(out.data());
+                 });
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const BenchOptions options = parseBenchOptions(argc, argv);
+  // Library code logs to stdout; keep stdout for results only.
+  std::streambuf *coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+  std::cerr << "sum_squares: " << sumSquaresKernel().name
+            << ", pcm16: " << pcmInt16Kernel().name
+            << ", pcm24: " << pcmInt24Kernel().name
+            << ", pcm32: " << pcmInt32Kernel().name
+            << ", k_weighting: " << kWeightKernel().name
+            << ", displace: " << displaceKernel().name << "\n";
+
+  Runner runner(options);
+  benchSumSquares(runner);
+  benchPcmSumSquares(runner);
+  benchKWeighting(runner);
+  benchGeometry(runner);
+  benchShaderMath(runner);
+  benchLoudness(runner, options);
+
+  std::cout.rdbuf(coutBuffer);
+  return 0;
+}
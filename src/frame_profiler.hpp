@@ -0,0 +1,284 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-frame timing for the render loop: CPU time of a few fixed scopes, GPU
+// time of the draw, and how far the displayed epoch trails the audio clock.
+// Everything runs on the render thread.
+//
+// A disabled profiler records nothing; a Scope then costs one branch and
+// never reads the clock, so the calls can stay in the loop unconditionally.
+//
+// GPU times come from Room's GL_TIME_ELAPSED queries, which resolve a frame or
+// two late. gpuQueryIssued() remembers which frame each query belongs to so
+// addGpuTime() can file the result under that frame instead of the one that
+// happened to collect it.
+class FrameProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+  enum ScopeId { EpochFetch, Upload, Draw, Swap, Readback, kNumScopes };
+  static constexpr const char *kScopeNames[kNumScopes] = {
+      "epoch_fetch", "upload", "draw", "swap", "readback"};
+  // Frames the exit summary covers, newest last.
+  static constexpr size_t kSummaryFrames = 3600;
+
+  struct FrameRecord {
+    double start_us = 0.0; // From the profiler's construction.
+    double frame_us = 0.0;
+    double scopeStart_us[kNumScopes] = {};
+    double scope_us[kNumScopes] = {};
+    double gpu_ms = NAN;      // NaN until (unless) the query resolves.
+    double epochLag_ms = NAN; // NaN before the first epoch is shown.
+  };
+
+  // RAII CPU scope. Scopes of one id may repeat within a frame; their times
+  // add up.
+  class Scope {
+  public:
+    Scope(FrameProfiler &profiler, ScopeId id)
+        : profiler(profiler.enabled ? &profiler : nullptr), id(id) {
+      if (this->profiler != nullptr) {
+        start = Clock::now();
+      }
+    }
+    ~Scope() {
+      if (profiler != nullptr) {
+        profiler->addScope(id, start, Clock::now());
+      }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    FrameProfiler *profiler;
+    ScopeId id;
+    Clock::time_point start;
+  };
+
+  // `outputPath` selects the export: *.csv writes one row per frame, anything
+  // else Chrome trace JSON (chrome://tracing, Perfetto). Empty disables the
+  // profiler.
+  explicit FrameProfiler(std::string outputPath)
+      : enabled(!outputPath.empty()), kOutputPath(std::move(outputPath)),
+        kOrigin(Clock::now()) {
+    if (enabled) {
+      // An hour at 60 fps, so recording doesn't reallocate mid-run.
+      frames.reserve(60 * 60 * 60);
+    }
+  }
+
+  FrameProfiler(const FrameProfiler &) = delete;
+  FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+  bool isEnabled() const { return enabled; }
+
+  void beginFrame() {
+    if (!enabled) {
+      return;
+    }
+    frames.emplace_back();
+    frames.back().start_us = micros(Clock::now());
+  }
+  void endFrame() {
+    if (!enabled || frames.empty()) {
+      return;
+    }
+    FrameRecord &frame = frames.back();
+    frame.frame_us = micros(Clock::now()) - frame.start_us;
+  }
+
+  // Audio time minus the timestamp of the epoch on screen.
+  void setEpochLag(double lag_ms) {
+    if (enabled && !frames.empty()) {
+      frames.back().epochLag_ms = lag_ms;
+    }
+  }
+
+  // A GPU query for the current frame started; its result will come back
+  // through addGpuTime() in issue order.
+  void gpuQueryIssued() {
+    if (enabled && !frames.empty()) {
+      gpuPending.push_back(frames.size() - 1);
+    }
+  }
+  void addGpuTime(double gpu_ms) {
+    if (!enabled || gpuPending.empty()) {
+      return;
+    }
+    frames[gpuPending.front()].gpu_ms = gpu_ms;
+    gpuPending.pop_front();
+  }
+
+  // Writes the export chosen at construction. Returns false (and reports) on
+  // an I/O error.
+  bool write() const {
+    if (!enabled) {
+      return true;
+    }
+    std::FILE *file = std::fopen(kOutputPath.c_str(), "w");
+    if (file == nullptr) {
+      std::cout << "ERROR::PROFILER::OPEN_FAILED: " << kOutputPath
+                << std::endl;
+      return false;
+    }
+    const bool csv = kOutputPath.size() >= 4 &&
+                     kOutputPath.compare(kOutputPath.size() - 4, 4, ".csv") == 0;
+    csv ? writeCsv(file) : writeTrace(file);
+    const bool ok = !std::ferror(file);
+    if (std::fclose(file) != 0 || !ok) {
+      std::cout << "ERROR::PROFILER::WRITE_FAILED: " << kOutputPath
+                << std::endl;
+      return false;
+    }
+    std::cout << "Profile: " << frames.size() << " frames written to "
+              << kOutputPath << "\n";
+    return true;
+  }
+
+  // p50 / p95 / p99 of every metric over the last kSummaryFrames frames.
+  void printSummary(std::ostream &out) const {
+    if (!enabled || frames.empty()) {
+      return;
+    }
+    const size_t first =
+        frames.size() > kSummaryFrames ? frames.size() - kSummaryFrames : 0;
+    out << "Frame times over the last " << frames.size() - first
+        << " frames (ms, p50 / p95 / p99):\n";
+    printPercentiles(out, "frame", first,
+                     [](const FrameRecord &f) { return f.frame_us / 1000.0; });
+    for (int s = 0; s < kNumScopes; ++s) {
+      printPercentiles(out, kScopeNames[s], first, [s](const FrameRecord &f) {
+        return f.scope_us[s] > 0.0 ? f.scope_us[s] / 1000.0 : NAN;
+      });
+    }
+    printPercentiles(out, "gpu", first,
+                     [](const FrameRecord &f) { return f.gpu_ms; });
+    printPercentiles(out, "epoch_lag", first,
+                     [](const FrameRecord &f) { return f.epochLag_ms; });
+  }
+
+private:
+  double micros(Clock::time_point t) const {
+    return std::chrono::duration<double, std::micro>(t - kOrigin).count();
+  }
+
+  void addScope(ScopeId id, Clock::time_point start, Clock::time_point end) {
+    if (frames.empty()) {
+      return;
+    }
+    FrameRecord &frame = frames.back();
+    if (frame.scope_us[id] == 0.0) {
+      frame.scopeStart_us[id] = micros(start);
+    }
+    frame.scope_us[id] +=
+        std::chrono::duration<double, std::micro>(end - start).count();
+  }
+
+  // Metrics that are NaN for a frame (no sample) are left out; metrics with
+  // no samples at all aren't printed.
+  template <typename Metric>
+  void printPercentiles(std::ostream &out, const char *name, size_t first,
+                        Metric &&metric) const {
+    std::vector<double> values;
+    values.reserve(frames.size() - first);
+    for (size_t i = first; i < frames.size(); ++i) {
+      const double value = metric(frames[i]);
+      if (!std::isnan(value)) {
+        values.push_back(value);
+      }
+    }
+    if (values.empty()) {
+      return;
+    }
+    auto percentile = [&values](double p) {
+      const size_t k = std::min(values.size() - 1,
+                                static_cast<size_t>(p * values.size()));
+      std::nth_element(values.begin(), values.begin() + k, values.end());
+      return values[k];
+    };
+    char line[128];
+    std::snprintf(line, sizeof(line), "  %-12s %8.3f / %8.3f / %8.3f\n", name,
+                  percentile(0.50), percentile(0.95), percentile(0.99));
+    out << line;
+  }
+
+  void writeCsv(std::FILE *file) const {
+    std::fprintf(file, "frame,start_ms,frame_ms");
+    for (const char *name : kScopeNames) {
+      std::fprintf(file, ",%s_ms", name);
+    }
+    std::fprintf(file, ",gpu_ms,epoch_lag_ms\n");
+    for (size_t i = 0; i < frames.size(); ++i) {
+      const FrameRecord &frame = frames[i];
+      std::fprintf(file, "%zu,%.3f,%.3f", i, frame.start_us / 1000.0,
+                   frame.frame_us / 1000.0);
+      for (double scope_us : frame.scope_us) {
+        std::fprintf(file, ",%.3f", scope_us / 1000.0);
+      }
+      // Missing samples are empty cells rather than "nan".
+      std::isnan(frame.gpu_ms) ? std::fprintf(file, ",")
+                               : std::fprintf(file, ",%.3f", frame.gpu_ms);
+      std::isnan(frame.epochLag_ms)
+          ? std::fprintf(file, ",\n")
+          : std::fprintf(file, ",%.3f\n", frame.epochLag_ms);
+    }
+  }
+
+  // CPU scopes are complete ("X") events on one track, GPU draws on a second
+  // track starting with their frame (the GPU clock isn't correlated with the
+  // CPU one), and the epoch lag a counter.
+  void writeTrace(std::FILE *file) const {
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"tid\":1,\"name\":"
+                       "\"thread_name\",\"args\":{\"name\":\"render\"}},\n");
+    std::fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"tid\":2,\"name\":"
+                       "\"thread_name\",\"args\":{\"name\":\"gpu\"}}");
+    for (size_t i = 0; i < frames.size(); ++i) {
+      const FrameRecord &frame = frames[i];
+      std::fprintf(file,
+                   ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":1,\"name\":\"frame\","
+                   "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%zu}}",
+                   frame.start_us, frame.frame_us, i);
+      for (int s = 0; s < kNumScopes; ++s) {
+        if (frame.scope_us[s] > 0.0) {
+          std::fprintf(file,
+                       ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":1,\"name\":\"%s\","
+                       "\"ts\":%.3f,\"dur\":%.3f}",
+                       kScopeNames[s], frame.scopeStart_us[s],
+                       frame.scope_us[s]);
+        }
+      }
+      if (!std::isnan(frame.gpu_ms)) {
+        std::fprintf(file,
+                     ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":2,\"name\":\"draw\","
+                     "\"ts\":%.3f,\"dur\":%.3f}",
+                     frame.start_us, frame.gpu_ms * 1000.0);
+      }
+      if (!std::isnan(frame.epochLag_ms)) {
+        std::fprintf(file,
+                     ",\n{\"ph\":\"C\",\"pid\":1,\"name\":\"epoch_lag_ms\","
+                     "\"ts\":%.3f,\"args\":{\"lag\":%.3f}}",
+                     frame.start_us, frame.epochLag_ms);
+      }
+    }
+    std::fprintf(file, "\n]}\n");
+  }
+
+  const bool enabled;
+  const std::string kOutputPath;
+  const Clock::time_point kOrigin;
+  std::vector<FrameRecord> frames;
+  std::deque<size_t> gpuPending;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Reads rendered frames back through a ring of pixel buffer objects.
+// glReadPixels into a bound PBO returns as soon as the copy is queued, so a
+// frame is only mapped once `count - 1` newer frames have been submitted and
+// the copy has long finished; readback overlaps rendering instead of stalling
+// it every frame.
+class PboReadback {
+public:
+  PboReadback(int width, int height, int count = 3)
+      : kWidth(width), kHeight(height),
+        kFrameBytes(static_cast<size_t>(width) * height * 4),
+        pbos(std::max(count, 1)) {
+    glGenBuffers(pbos.size(), pbos.data());
+    for (GLuint pbo : pbos) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+      glBufferData(GL_PIXEL_PACK_BUFFER, kFrameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+  // Must run while the GL context is still current.
+  void destroy() {
+    glDeleteBuffers(pbos.size(), pbos.data());
+    pbos.clear();
+  }
+
+  PboReadback(const PboReadback &) = delete;
+  PboReadback &operator=(const PboReadback &) = delete;
+
+  size_t getFrameBytes() const { return kFrameBytes; }
+
+  // Queues a copy of the bound read framebuffer. If every PBO is still
+  // pending, the oldest frame is retired through `consume` first. `consume`
+  // gets RGBA rows bottom-up, as glReadPixels lays them out, and returns false
+  // to report a failed write.
+  template <typename Consume> bool push(Consume &&consume) {
+    bool ok = true;
+    if (pending == pbos.size()) {
+      ok = retire(consume);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[(oldest + pending) % pbos.size()]);
+    glReadPixels(0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    ++pending;
+    return ok;
+  }
+
+  // Retires every pending frame, oldest first.
+  template <typename Consume> bool drain(Consume &&consume) {
+    bool ok = true;
+    while (pending > 0 && ok) {
+      ok = retire(consume);
+    }
+    return ok;
+  }
+
+private:
+  template <typename Consume> bool retire(Consume &consume) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[oldest]);
+    const auto *pixels = static_cast<const uint8_t *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, kFrameBytes, GL_MAP_READ_BIT));
+    const bool ok = pixels != nullptr && consume(pixels);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    oldest = (oldest + 1) % pbos.size();
+    --pending;
+    return ok;
+  }
+
+  const int kWidth;
+  const int kHeight;
+  const size_t kFrameBytes;
+  std::vector<GLuint> pbos;
+  size_t oldest = 0;
+  size_t pending = 0;
+};
+
+// Streams frames as raw packed RGB24 or as YUV4MPEG2 (4:4:4, full-range
+// BT.601), both top row first, for piping into an encoder, e.g.
+//   window --headless --format y4m track.wav | ffmpeg -i - out.mp4
+class FrameWriter {
+public:
+  enum Format { kRgb, kY4m };
+
+  FrameWriter(FILE *out, int width, int height, int fps, Format format)
+      : out(out), kWidth(width), kHeight(height), kFormat(format),
+        frame(static_cast<size_t>(width) * height * 3) {
+    if (kFormat == kY4m) {
+      const std::string header =
+          "YUV4MPEG2 W" + std::to_string(width) + " H" +
+          std::to_string(height) + " F" + std::to_string(fps) +
+          ":1 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+      ok = std::fwrite(header.data(), 1, header.size(), out) == header.size();
+    }
+  }
+
+  // Parses "rgb" or "y4m"; anything else falls back to y4m.
+  static Format parseFormat(const std::string &name) {
+    return name == "rgb" ? kRgb : kY4m;
+  }
+
+  // Writes one frame of bottom-up RGBA rows. Returns false once the output
+  // has failed (e.g. the encoder exited).
+  bool write(const uint8_t *rgba) {
+    if (!ok) {
+      return false;
+    }
+    if (kFormat == kRgb) {
+      packRgb(rgba);
+    } else {
+      static const char kFrameTag[] = "FRAME\n";
+      ok = std::fwrite(kFrameTag, 1, sizeof(kFrameTag) - 1, out) ==
+           sizeof(kFrameTag) - 1;
+      packYuv444(rgba);
+    }
+    ok = ok && std::fwrite(frame.data(), 1, frame.size(), out) == frame.size();
+    return ok;
+  }
+
+private:
+  void packRgb(const uint8_t *rgba) {
+    uint8_t *dst = frame.data();
+    for (int y = kHeight - 1; y >= 0; --y) {
+      const uint8_t *src = rgba + static_cast<size_t>(y) * kWidth * 4;
+      for (int x = 0; x < kWidth; ++x, src += 4, dst += 3) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+      }
+    }
+  }
+
+  // Planar Y, Cb, Cr with 8-bit fixed-point BT.601 coefficients.
+  void packYuv444(const uint8_t *rgba) {
+    const size_t planeSize = static_cast<size_t>(kWidth) * kHeight;
+    uint8_t *yPlane = frame.data();
+    uint8_t *uPlane = yPlane + planeSize;
+    uint8_t *vPlane = uPlane + planeSize;
+    size_t i = 0;
+    for (int y = kHeight - 1; y >= 0; --y) {
+      const uint8_t *src = rgba + static_cast<size_t>(y) * kWidth * 4;
+      for (int x = 0; x < kWidth; ++x, src += 4, ++i) {
+        const int r = src[0], g = src[1], b = src[2];
+        yPlane[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        uPlane[i] = static_cast<uint8_t>(std::min(
+            255, ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128));
+        vPlane[i] = static_cast<uint8_t>(std::min(
+            255, ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128));
+      }
+    }
+  }
+
+  FILE *out;
+  const int kWidth;
+  const int kHeight;
+  const Format kFormat;
+  std::vector<uint8_t> frame;
+  bool ok = true;
+};
+
+#endif
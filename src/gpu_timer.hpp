@@ -0,0 +1,72 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Measures GPU time between begin() and end() with GL_TIME_ELAPSED queries.
+// Queries rotate through a small ring and are only read once the driver
+// reports them available, so timing never stalls the pipeline; results
+// arrive a frame or two late. A begin() with every query still in flight is
+// skipped rather than waited on.
+class GpuTimer {
+public:
+  explicit GpuTimer(int depth = 4) : queries(depth < 1 ? 1 : depth) {
+    glGenQueries(queries.size(), queries.data());
+  }
+  // Must run while the GL context is still current.
+  void destroy() {
+    glDeleteQueries(queries.size(), queries.data());
+    queries.clear();
+  }
+
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  // Returns false when the query was skipped; end() is still safe to call.
+  bool begin() {
+    active = pending < queries.size();
+    if (active) {
+      glBeginQuery(GL_TIME_ELAPSED,
+                   queries[(oldest + pending) % queries.size()]);
+    }
+    return active;
+  }
+  void end() {
+    if (active) {
+      glEndQuery(GL_TIME_ELAPSED);
+      ++pending;
+      active = false;
+    }
+  }
+
+  // Collects every finished query, oldest first, through consume(ms).
+  // Returns how many there were.
+  template <typename Consume> int poll(Consume &&consume) {
+    int collected = 0;
+    while (pending > 0) {
+      GLint available = 0;
+      glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE,
+                         &available);
+      if (!available) {
+        break;
+      }
+      GLuint64 ns = 0;
+      glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &ns);
+      consume(ns * 1e-6);
+      oldest = (oldest + 1) % queries.size();
+      --pending;
+      ++collected;
+    }
+    return collected;
+  }
+
+private:
+  std::vector<GLuint> queries;
+  size_t oldest = 0;
+  size_t pending = 0;
+  bool active = false;
+};
+
+#endif
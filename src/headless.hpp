@@ -0,0 +1,293 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "frame_profiler.hpp"
+#include "frame_readback.hpp"
+#include "headless_context.hpp"
+#include "options.hpp"
+#include "room.hpp"
+#include "shard_merger.hpp"
+#include "speaker_points/speaker_dbs.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Offline rendering: time advances by exactly 1 / fps per frame, each frame
+// shows the envelope at that time, and frames stream to stdout for an
+// encoder in the next pipeline stage. Nothing waits on a wall clock, so this
+// runs as fast as the renderer and readback allow.
+//
+// With --shards N the frames are rendered by N child processes, each with its
+// own EGL context (and, on llvmpipe, its own cores), taking every Nth chunk
+// of the timeline (ShardMerger). A frame depends only on its time and the
+// envelope, so the shards need no coordination. The parent only counts
+// frames (and, outside LUFS mode, writes the envelope sidecar once) and
+// stitches the children's frames back in order. On a cold cache every child
+// writes the same program binaries and mip chains; each cache writes through
+// replaceFile(), so the children's files never mix.
+
+inline long headlessFrameCount(const RunOptions &options,
+                               const LoudnessGenerator &generator) {
+  long numFrames =
+      static_cast<long>(std::ceil(generator.getLength_s() * options.fps));
+  if (options.maxFrames >= 0) {
+    numFrames = std::min(numFrames, options.maxFrames);
+  }
+  return numFrames;
+}
+
+// Renders the frames of shard `shard` of `numShards` (all of them for one
+// shard), handing each to consume(rgba) as bottom-up RGBA rows in timeline
+// order. consume returns false to report a failed write. Returns 0 or -1.
+template <typename Consume>
+inline int renderFrames(const RunOptions &options, int shard, int numShards,
+                        Consume &&consume) {
+  HeadlessContext context;
+  if (!context.create()) {
+    context.destroy();
+    return -1;
+  }
+
+  // No default framebuffer without a surface; render into an FBO instead.
+  GLuint fbo, colorBuffer;
+  glGenFramebuffers(1, &fbo);
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, options.width,
+                        options.height);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorBuffer);
+  int status = 0;
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+    status = -1;
+  } else {
+    glViewport(0, 0, options.width, options.height);
+    LoudnessGenerator loudnessGenerator = Room::makeLoudnessGenerator(options);
+    const SpeakerLayout layout = SpeakerLayout::resolve(
+        options.layout, loudnessGenerator.getNumChannels());
+    loudnessGenerator.setChannelWeights(layout.getLoudnessWeights());
+    Room room(options, layout);
+    const int numBands = loudnessGenerator.getNumBands();
+    room.setUseBands(numBands == 3);
+    room.setEpochPeriod(loudnessGenerator.getEpochPeriod_s());
+    room.finishLoading();
+
+    const long numFrames = headlessFrameCount(options, loudnessGenerator);
+
+    PboReadback readback(options.width, options.height, options.pboCount);
+
+    FrameProfiler profiler(options.profilePath);
+    room.setProfiler(profiler);
+
+    const auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    long frame = 0;
+    long rendered = 0;
+    long nextEpoch = 0;
+    bool epochsDone = false;
+    for (; frame < numFrames && ok; ++frame) {
+      if (ShardMerger::shardOf(frame, numShards) != shard) {
+        continue;
+      }
+      profiler.beginFrame();
+      const auto frameStart = std::chrono::steady_clock::now();
+      const float time = static_cast<float>(static_cast<double>(frame) /
+                                            options.fps);
+      room.setTime(time);
+      {
+        // A batch of upcoming epochs whenever the room's history runs low.
+        FrameProfiler::Scope scope(profiler, FrameProfiler::EpochFetch);
+        const double period_s = loudnessGenerator.getEpochPeriod_s();
+        if (!epochsDone && room.needsEpochs()) {
+          // After skipping other shards' chunks, start at the first epoch
+          // this frame reads rather than the one after the last batch.
+          nextEpoch = std::max(
+              nextEpoch, std::lround(room.getEpochWindowStart_s() / period_s));
+          const float horizon_s = room.getEpochHorizon_s();
+          for (; nextEpoch * period_s < horizon_s; ++nextEpoch) {
+            const LoudnessEpoch epoch =
+                loudnessGenerator.epochAt((nextEpoch + 0.5) * period_s);
+            if (epoch.timeStamp < 0) {
+              epochsDone = true;
+              break;
+            }
+            room.addEpoch(epoch, numBands);
+          }
+        }
+      }
+      if (const float shown = room.getShownEpochTime(); shown >= 0) {
+        profiler.setEpochLag((time - shown) * 1000.0);
+      }
+      room.draw();
+      {
+        FrameProfiler::Scope scope(profiler, FrameProfiler::Readback);
+        ok = readback.push(consume);
+      }
+      room.endFrame(std::chrono::steady_clock::now() - frameStart);
+      profiler.endFrame();
+      ++rendered;
+    }
+    ok = readback.drain(consume) && ok;
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double audio_s = static_cast<double>(rendered) / options.fps;
+    std::cout << "Rendered " << rendered << " frames (" << audio_s << " s) in "
+              << elapsed.count() << " s, " << audio_s / elapsed.count()
+              << "x real time\n";
+    if (loudnessGenerator.getMode() == LoudnessMode::kLufs && numShards == 1) {
+      std::cout << "Integrated loudness: "
+                << loudnessGenerator.getIntegratedLufs() << " LUFS\n";
+    }
+    if (!ok) {
+      std::cout << "ERROR::HEADLESS::OUTPUT_FAILED: stopped at frame " << frame
+                << std::endl;
+      status = -1;
+    }
+    profiler.printSummary(std::cout);
+    profiler.write();
+
+    readback.destroy();
+    room.destroy();
+  }
+
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &colorBuffer);
+  context.destroy();
+  return status;
+}
+
+// Forks one renderer per shard before any GL state exists in this process,
+// then merges their frames into `writer`.
+inline int renderSharded(const RunOptions &options, FrameWriter &writer) {
+  long numFrames = 0;
+  {
+    LoudnessGenerator loudnessGenerator = Room::makeLoudnessGenerator(options);
+    // Writes the envelope sidecar if there isn't one, so the children map it
+    // instead of each decoding the track. LUFS analysis has none.
+    if (loudnessGenerator.getMode() == LoudnessMode::kRms) {
+      loudnessGenerator.analyzeRange();
+    }
+    numFrames = headlessFrameCount(options, loudnessGenerator);
+  }
+  const size_t frameBytes = static_cast<size_t>(options.width) *
+                            options.height * 4;
+
+  std::cout.flush();
+  std::fflush(nullptr);
+  std::vector<int> readEnds;
+  std::vector<pid_t> children;
+  for (int shard = 0; shard < options.shards; ++shard) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+      std::cout << "ERROR::HEADLESS::PIPE_FAILED" << std::endl;
+      break;
+    }
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+      // Child: render this shard's frames into the pipe.
+      ::close(fds[0]);
+      for (int fd : readEnds) {
+        ::close(fd);
+      }
+      RunOptions shardOptions = options;
+      if (!shardOptions.profilePath.empty()) {
+        shardOptions.profilePath += ".shard" + std::to_string(shard);
+      }
+      const int writeEnd = fds[1];
+      const int status = renderFrames(
+          shardOptions, shard, options.shards,
+          [writeEnd, frameBytes](const uint8_t *rgba) {
+            for (size_t done = 0; done < frameBytes;) {
+              const ssize_t n =
+                  ::write(writeEnd, rgba + done, frameBytes - done);
+              if (n < 0 && errno == EINTR) {
+                continue;
+              }
+              if (n <= 0) {
+                return false;
+              }
+              done += n;
+            }
+            return true;
+          });
+      std::cout.flush();
+      // Skip the parent's atexit handlers and stdio buffers.
+      ::_exit(status == 0 ? 0 : 1);
+    }
+    ::close(fds[1]);
+    if (pid < 0) {
+      ::close(fds[0]);
+      std::cout << "ERROR::HEADLESS::FORK_FAILED" << std::endl;
+      break;
+    }
+    readEnds.push_back(fds[0]);
+    children.push_back(pid);
+  }
+
+  bool ok = children.size() == static_cast<size_t>(options.shards);
+  if (ok) {
+    std::cout << "Rendering " << numFrames << " frames in " << options.shards
+              << " shards\n";
+    const auto start = std::chrono::steady_clock::now();
+    ShardMerger merger(readEnds, frameBytes);
+    ok = merger.run(numFrames, [&writer](const uint8_t *rgba) {
+      return writer.write(rgba);
+    });
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double audio_s = static_cast<double>(numFrames) / options.fps;
+    std::cout << "Sharded render: " << audio_s << " s of audio in "
+              << elapsed.count() << " s, " << audio_s / elapsed.count()
+              << "x real time\n";
+  } else {
+    for (int fd : readEnds) {
+      ::close(fd);
+    }
+  }
+  // Closing the read ends (merger going out of scope) stops any child still
+  // writing with EPIPE.
+  for (pid_t pid : children) {
+    int childStatus = 0;
+    ::waitpid(pid, &childStatus, 0);
+    ok = ok && WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == 0;
+  }
+  if (!ok) {
+    std::cout << "ERROR::HEADLESS::SHARD_FAILED" << std::endl;
+  }
+  return ok ? 0 : -1;
+}
+
+inline int runHeadless(const RunOptions &options) {
+  // stdout carries frames only; route every log line to stderr.
+  std::streambuf *coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+  // An encoder that exits early must surface as a failed write.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  FrameWriter writer(stdout, options.width, options.height, options.fps,
+                     FrameWriter::parseFormat(options.format));
+  int status;
+  if (options.shards > 1) {
+    status = renderSharded(options, writer);
+  } else {
+    status = renderFrames(options, 0, 1, [&writer](const uint8_t *rgba) {
+      return writer.write(rgba);
+    });
+  }
+  std::fflush(stdout);
+
+  std::cout.rdbuf(coutBuffer);
+  return status;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// Keep eglplatform.h from pulling in Xlib; nothing here needs a display
+// server.
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include "program_binary_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// An OpenGL 3.3 core context with no window, for rendering into FBOs on
+// machines without a display or GPU (e.g. Mesa's llvmpipe on build boxes).
+// Prefers Mesa's surfaceless platform and falls back to the default display;
+// a 1x1 pbuffer is made current only if the driver can't bind a context
+// without a surface.
+class HeadlessContext {
+public:
+  // Creates the context, makes it current and loads GL through glad.
+  bool create() {
+    display = getDisplay();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+      std::cout << "ERROR::EGL::NO_DISPLAY: 0x" << std::hex << eglGetError()
+                << std::dec << std::endl;
+      return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+      std::cout << "ERROR::EGL::NO_OPENGL_API" << std::endl;
+      return false;
+    }
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                                    EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE,
+                                    EGL_OPENGL_BIT,
+                                    EGL_RED_SIZE,
+                                    8,
+                                    EGL_GREEN_SIZE,
+                                    8,
+                                    EGL_BLUE_SIZE,
+                                    8,
+                                    EGL_ALPHA_SIZE,
+                                    8,
+                                    EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) ||
+        numConfigs == 0) {
+      std::cout << "ERROR::EGL::NO_CONFIG" << std::endl;
+      return false;
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     3,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     3,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+      std::cout << "ERROR::EGL::CONTEXT_CREATION_FAILED: 0x" << std::hex
+                << eglGetError() << std::dec << std::endl;
+      return false;
+    }
+
+    if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS),
+                      "EGL_KHR_surfaceless_context")) {
+      const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+      surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+      std::cout << "ERROR::EGL::MAKE_CURRENT_FAILED: 0x" << std::hex
+                << eglGetError() << std::dec << std::endl;
+      return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+      std::cout << "Failed to initialize GLAD" << std::endl;
+      return false;
+    }
+    loadProgramBinaryApi((GLADloadproc)eglGetProcAddress);
+    std::cout << "Headless EGL " << major << "." << minor << ": "
+              << glGetString(GL_RENDERER) << "\n";
+    return true;
+  }
+
+  void destroy() {
+    if (display == EGL_NO_DISPLAY) {
+      return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) {
+      eglDestroySurface(display, surface);
+    }
+    if (context != EGL_NO_CONTEXT) {
+      eglDestroyContext(display, context);
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+  }
+
+private:
+  static bool hasExtension(const char *extensions, const char *name) {
+    if (extensions == nullptr) {
+      return false;
+    }
+    const size_t length = std::strlen(name);
+    for (const char *at = std::strstr(extensions, name); at != nullptr;
+         at = std::strstr(at + length, name)) {
+      if ((at == extensions || at[-1] == ' ') &&
+          (at[length] == ' ' || at[length] == '\0')) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static EGLDisplay getDisplay() {
+    // Client extensions are queried on EGL_NO_DISPLAY.
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+      auto getPlatformDisplay =
+          (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+              "eglGetPlatformDisplayEXT");
+      if (getPlatformDisplay != nullptr) {
+        EGLDisplay surfaceless = getPlatformDisplay(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (surfaceless != EGL_NO_DISPLAY) {
+          return surfaceless;
+        }
+      }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  EGLSurface surface = EGL_NO_SURFACE;
+};
+
+#endif
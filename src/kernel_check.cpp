@@ -0,0 +1,623 @@
+// Checks every SIMD kernel the running CPU supports against its scalar
+// reference: sum of squares, integer PCM sums, K-weighting and the room.vs
+// displacement. Lengths are odd and offsets unaligned so each kernel's tail
+// handling runs too. Also checks WavReader::readSumSquares() and
+// LoudnessPyramid queries against brute force (and analyzeRange()) on small
+// WAVs written to the temp directory. Needs no GL context; registered with
+// ctest.
+//
+//   kernel_check
+//
+// Prints one line per mismatch and a summary; exits non-zero on any mismatch.
+#include "speaker_points/displacement_engine.hpp"
+#include "speaker_points/k_weighting.hpp"
+#include "speaker_points/loudness_pyramid.hpp"
+#include "speaker_points/pcm_sum_squares.hpp"
+#include "speaker_points/sum_squares.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Whether the running CPU has `features` (comma separated, as in the target
+// attributes); always true for the kernels compiled without one.
+bool cpuSupports(const std::string &features) {
+#ifdef SUM_SQUARES_X86
+  __builtin_cpu_init();
+  size_t start = 0;
+  while (start < features.size()) {
+    const size_t end = std::min(features.find(',', start), features.size());
+    const std::string feature = features.substr(start, end - start);
+    // __builtin_cpu_supports only takes literals.
+    const bool has = feature == "sse2"     ? __builtin_cpu_supports("sse2")
+                     : feature == "sse4.1" ? __builtin_cpu_supports("sse4.1")
+                     : feature == "avx2"   ? __builtin_cpu_supports("avx2")
+                     : feature == "fma"    ? __builtin_cpu_supports("fma")
+                     : feature == "avx512f"
+                         ? __builtin_cpu_supports("avx512f")
+                         : false;
+    if (!has) {
+      return false;
+    }
+    start = end + 1;
+  }
+#endif
+  (void)features;
+  return true;
+}
+
+template <typename Kernel> struct Candidate {
+  Kernel kernel;
+  const char *features;
+};
+
+class Checker {
+public:
+  // Records one comparison; prints it if it failed.
+  void expect(bool ok, const std::string &what) {
+    ++numChecks;
+    if (!ok) {
+      ++numFailures;
+      std::cout << "MISMATCH: " << what << "\n";
+    }
+  }
+
+  // |a - b| within `rel` of the larger magnitude (or `abs` absolute).
+  static bool near(double a, double b, double rel, double abs = 0.0) {
+    return std::abs(a - b) <= std::max(abs, rel * std::max(std::abs(a),
+                                                            std::abs(b)));
+  }
+
+  int summary() const {
+    std::cout << numChecks - numFailures << " / " << numChecks
+              << " kernel checks passed\n";
+    return numFailures == 0 ? 0 : 1;
+  }
+
+private:
+  size_t numChecks = 0;
+  size_t numFailures = 0;
+};
+
+// Every length up to 70 (covering each vector width's tails), a few epoch
+// lengths, and offsets that leave the data unaligned.
+void checkSumSquares(Checker &checker) {
+  const std::vector<Candidate<SumSquaresKernel>> candidates = {
+#ifdef SUM_SQUARES_X86
+      {{"sse2", sumSquaresSse2}, "sse2"},
+      {{"avx2", sumSquaresAvx2}, "avx2,fma"},
+      {{"avx512", sumSquaresAvx512}, "avx512f"},
+#elif defined(SUM_SQUARES_NEON)
+      {{"neon", sumSquaresNeon}, ""},
+#endif
+      {sumSquaresKernel(), ""},
+  };
+  std::vector<float> x(100003 + 3);
+  std::minstd_rand rng(1);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (float &v : x) {
+    v = dist(rng);
+  }
+  std::vector<size_t> lengths;
+  for (size_t n = 0; n <= 70; ++n) {
+    lengths.push_back(n);
+  }
+  lengths.insert(lengths.end(), {1323, 1440, 1441, 100003});
+  for (const auto &c : candidates) {
+    if (!cpuSupports(c.features)) {
+      continue;
+    }
+    for (size_t offset = 0; offset < 4; ++offset) {
+      for (size_t n : lengths) {
+        const float *in = x.data() + offset;
+        const double want = sumSquaresScalar(in, n);
+        const double got = c.kernel.fn(in, n);
+        checker.expect(Checker::near(got, want, 1e-12),
+                       std::string("sum_squares_") + c.kernel.name + " n=" +
+                           std::to_string(n) + " offset=" +
+                           std::to_string(offset));
+      }
+    }
+  }
+}
+
+// Integer sums are exact, so every kernel must match the scalar one bit for
+// bit: the packed 1/2/4/8-channel layouts the vector paths take, layouts
+// that fall back to scalar (3 and 6 channels, a padded stride), and frame
+// counts that leave a tail. Full-scale samples check the accumulators
+// don't overflow.
+void checkPcmSumSquares(Checker &checker) {
+  struct PcmFormat {
+    int bits;
+    PcmSumSquaresFn scalar;
+    const PcmSumSquaresKernel &(*resolve)();
+  };
+  const PcmFormat formats[] = {
+      {16, pcmSumSquaresInt16Scalar, pcmInt16Kernel},
+      {24, pcmSumSquaresInt24Scalar, pcmInt24Kernel},
+  };
+  const std::vector<Candidate<PcmSumSquaresKernel>> candidates16 = {
+#ifdef SUM_SQUARES_X86
+      {{"sse2", pcmSumSquaresInt16Sse2}, "sse2"},
+      {{"avx2", pcmSumSquaresInt16Avx2}, "avx2"},
+#elif defined(SUM_SQUARES_NEON)
+      {{"neon", pcmSumSquaresInt16Neon}, ""},
+#endif
+  };
+  const std::vector<Candidate<PcmSumSquaresKernel>> candidates24 = {
+#ifdef SUM_SQUARES_X86
+      {{"sse4.1", pcmSumSquaresInt24Sse41}, "sse4.1"},
+#endif
+  };
+  std::minstd_rand rng(2);
+  for (const PcmFormat &format : formats) {
+    std::vector<Candidate<PcmSumSquaresKernel>> candidates =
+        format.bits == 16 ? candidates16 : candidates24;
+    candidates.push_back({format.resolve(), ""});
+    const int sampleBytes = format.bits / 8;
+    for (int numChannels : {1, 2, 3, 4, 6, 8}) {
+      for (size_t pad : {0, 2}) {
+        const size_t stride = numChannels * sampleBytes + pad;
+        for (size_t numFrames : {0, 1, 7, 15, 33, 1441, 65537}) {
+          for (bool fullScale : {false, true}) {
+            // One byte in, so the frames are unaligned.
+            std::vector<uint8_t> bytes(1 + numFrames * stride);
+            for (uint8_t &b : bytes) {
+              b = static_cast<uint8_t>(rng());
+            }
+            uint8_t *frames = bytes.data() + 1;
+            if (fullScale) {
+              // The most negative sample, whose square is the largest.
+              for (size_t i = 0; i < numFrames; ++i) {
+                for (int ch = 0; ch < numChannels; ++ch) {
+                  uint8_t *s = frames + i * stride + ch * sampleBytes;
+                  std::fill(s, s + sampleBytes - 1, 0);
+                  s[sampleBytes - 1] = 0x80;
+                }
+              }
+            }
+            std::vector<int64_t> want(numChannels, 3);
+            format.scalar(frames, numFrames, numChannels, stride,
+                          want.data());
+            for (const auto &c : candidates) {
+              if (!cpuSupports(c.features)) {
+                continue;
+              }
+              std::vector<int64_t> got(numChannels, 3);
+              c.kernel.fn(frames, numFrames, numChannels, stride, got.data());
+              checker.expect(
+                  got == want,
+                  "pcm" + std::to_string(format.bits) + "_sum_squares_" +
+                      c.kernel.name + " channels=" +
+                      std::to_string(numChannels) + " stride=" +
+                      std::to_string(stride) + " frames=" +
+                      std::to_string(numFrames) +
+                      (fullScale ? " full scale" : ""));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// int32 sums are double, so the vector kernels only match the scalar one to
+// rounding; same layouts and frame counts as above, full scale included.
+void checkPcmSumSquaresInt32(Checker &checker) {
+  std::vector<Candidate<PcmSumSquaresInt32Kernel>> candidates = {
+#ifdef SUM_SQUARES_X86
+      {{"sse2", pcmSumSquaresInt32Sse2}, "sse2"},
+      {{"avx2", pcmSumSquaresInt32Avx2}, "avx2,fma"},
+#elif defined(SUM_SQUARES_NEON)
+      {{"neon", pcmSumSquaresInt32Neon}, ""},
+#endif
+      {pcmInt32Kernel(), ""},
+  };
+  std::minstd_rand rng(3);
+  for (int numChannels : {1, 2, 3, 4, 6, 8}) {
+    for (size_t pad : {0, 4}) {
+      const size_t stride = numChannels * 4 + pad;
+      for (size_t numFrames : {0, 1, 7, 15, 33, 1441, 65537}) {
+        for (bool fullScale : {false, true}) {
+          std::vector<uint8_t> bytes(1 + numFrames * stride);
+          for (uint8_t &b : bytes) {
+            b = static_cast<uint8_t>(rng());
+          }
+          uint8_t *frames = bytes.data() + 1;
+          if (fullScale) {
+            for (size_t i = 0; i < numFrames; ++i) {
+              for (int ch = 0; ch < numChannels; ++ch) {
+                uint8_t *s = frames + i * stride + ch * 4;
+                std::fill(s, s + 3, 0);
+                s[3] = 0x80;
+              }
+            }
+          }
+          std::vector<double> want(numChannels, 3.0);
+          pcmSumSquaresInt32Scalar(frames, numFrames, numChannels, stride,
+                                   want.data());
+          for (const auto &c : candidates) {
+            if (!cpuSupports(c.features)) {
+              continue;
+            }
+            std::vector<double> got(numChannels, 3.0);
+            c.kernel.fn(frames, numFrames, numChannels, stride, got.data());
+            for (int ch = 0; ch < numChannels; ++ch) {
+              checker.expect(
+                  Checker::near(got[ch], want[ch], 1e-12),
+                  std::string("pcm32_sum_squares_") + c.kernel.name +
+                      " channels=" + std::to_string(numChannels) +
+                      " stride=" + std::to_string(stride) + " frames=" +
+                      std::to_string(numFrames) +
+                      (fullScale ? " full scale" : "") + " ch" +
+                      std::to_string(ch));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// One to three SIMD groups of channels, fed in uneven pieces so the state
+// carried between calls is checked along with the sums.
+void checkKWeighting(Checker &checker) {
+  const std::vector<Candidate<KWeightKernel>> candidates = {
+#ifdef SUM_SQUARES_X86
+      {{"avx2", kWeightAvx2}, "avx2,fma"},
+#elif defined(SUM_SQUARES_NEON)
+      {{"neon", kWeightNeon}, ""},
+#endif
+      {kWeightKernel(), ""},
+  };
+  std::minstd_rand rng(3);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  const size_t pieces[] = {1, 7, 1440, 333, 4801};
+  for (float sampleRate : {44100.f, 48000.f}) {
+    const KWeightCoeffs coeffs = KWeightCoeffs::forSampleRate(sampleRate);
+    for (int numLanes : {4, 8, 12}) {
+      const size_t stride = numLanes + 4;
+      size_t numFrames = 0;
+      for (size_t piece : pieces) {
+        numFrames += piece;
+      }
+      std::vector<float> frames(numFrames * stride);
+      for (float &v : frames) {
+        v = dist(rng);
+      }
+      std::vector<double> wantState(4 * numLanes), wantSums(numLanes);
+      std::vector<std::vector<double>> wantAfter;
+      {
+        size_t done = 0;
+        for (size_t piece : pieces) {
+          kWeightScalar(frames.data() + done * stride, piece, stride,
+                        numLanes, coeffs, wantState.data(), wantSums.data());
+          done += piece;
+          wantAfter.push_back(wantSums);
+          wantAfter.back().insert(wantAfter.back().end(), wantState.begin(),
+                                  wantState.end());
+        }
+      }
+      for (const auto &c : candidates) {
+        if (!cpuSupports(c.features)) {
+          continue;
+        }
+        std::vector<double> state(4 * numLanes), sums(numLanes);
+        size_t done = 0;
+        for (size_t p = 0; p < std::size(pieces); ++p) {
+          c.kernel.fn(frames.data() + done * stride, pieces[p], stride,
+                      numLanes, coeffs, state.data(), sums.data());
+          done += pieces[p];
+          std::vector<double> got = sums;
+          got.insert(got.end(), state.begin(), state.end());
+          bool ok = true;
+          for (size_t i = 0; i < got.size(); ++i) {
+            // FMA rounds differently; the filters are stable, so the gap
+            // stays at a few ulps of the signal.
+            ok = ok && Checker::near(got[i], wantAfter[p][i], 1e-9, 1e-12);
+          }
+          checker.expect(ok, std::string("k_weighting_") + c.kernel.name +
+                                 " lanes=" + std::to_string(numLanes) +
+                                 " rate=" +
+                                 std::to_string(int(sampleRate)) +
+                                 " after piece " + std::to_string(p));
+        }
+      }
+    }
+  }
+}
+
+// The vector kernels approximate acos and sin, so they get an absolute
+// tolerance on the displacement that grows with the ripple frequency (see
+// displacement_engine.hpp). Ranges start and end off the vector width so the
+// scalar tails run.
+void checkDisplacement(Checker &checker) {
+  const std::vector<Candidate<DisplaceKernel>> candidates = {
+#ifdef DISPLACEMENT_X86
+      {{"avx2", displaceAvx2}, "avx2,fma"},
+      {{"avx512", displaceAvx512}, "avx512f"},
+#elif defined(DISPLACEMENT_NEON)
+      {{"neon", displaceNeon}, ""},
+#endif
+      {displaceKernel(), ""},
+  };
+  const size_t n = 4099;
+  std::minstd_rand rng(4);
+  std::normal_distribution<float> normal;
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::vector<float> dirX(n), dirY(n), dirZ(n), radius(n);
+  for (size_t i = 0; i < n; ++i) {
+    float x = normal(rng), y = normal(rng), z = normal(rng);
+    const float len = std::sqrt(x * x + y * y + z * z);
+    dirX[i] = x / len;
+    dirY[i] = y / len;
+    dirZ[i] = z / len;
+    radius[i] = 1.f + unit(rng);
+  }
+  const DisplacementInput in{dirX.data(), dirY.data(), dirZ.data(),
+                             radius.data()};
+
+  for (int numSpkrs : {1, 2, 5}) {
+    for (float maxFrequency : {5.f, 40.f, 170.f}) {
+      DisplacementTerms terms;
+      for (int s = 0; s < numSpkrs; ++s) {
+        // Speakers on some of the points, where acos is least accurate.
+        const size_t on = rng() % n;
+        terms.posX.push_back(dirX[on]);
+        terms.posY.push_back(dirY[on]);
+        terms.posZ.push_back(dirZ[on]);
+        terms.weight.push_back(3.f * unit(rng));
+        terms.frequency.push_back(maxFrequency * unit(rng));
+      }
+      terms.scale = 0.5f;
+      float totalWeight = 0.f;
+      for (float w : terms.weight) {
+        totalWeight += w;
+      }
+      const double tolerance =
+          terms.scale * totalWeight * (2e-6 + 1e-5 * maxFrequency);
+
+      std::vector<float> want(4 * n), got(4 * n);
+      const DisplacementOutput wantOut{want.data(), want.data() + n,
+                                       want.data() + 2 * n,
+                                       want.data() + 3 * n};
+      const DisplacementOutput gotOut{got.data(), got.data() + n,
+                                      got.data() + 2 * n, got.data() + 3 * n};
+      const size_t begin = 3, end = n;
+      displaceScalar(in, begin, end, terms, wantOut);
+      for (const auto &c : candidates) {
+        if (!cpuSupports(c.features)) {
+          continue;
+        }
+        std::fill(got.begin(), got.end(), 0.f);
+        c.kernel.fn(in, begin, end, terms, gotOut);
+        // Positions are dir * (radius + displacement), so they can be off by
+        // as much as the displacement plus their own rounding.
+        double worst = 0.0;
+        bool untouched = true;
+        for (size_t i = 0; i < n; ++i) {
+          for (int k = 0; k < 4; ++k) {
+            const float a = got[k * n + i], b = want[k * n + i];
+            if (i < begin) {
+              untouched = untouched && a == 0.f;
+            } else {
+              worst = std::max<double>(
+                  worst, std::abs(a - b) - (k < 3 ? 1e-6 : 0.0));
+            }
+          }
+        }
+        checker.expect(worst <= tolerance && untouched,
+                       std::string("displace_") + c.kernel.name +
+                           " speakers=" + std::to_string(numSpkrs) +
+                           " max frequency=" +
+                           std::to_string(int(maxFrequency)) +
+                           " worst=" + std::to_string(worst) +
+                           " tolerance=" + std::to_string(tolerance));
+      }
+    }
+  }
+}
+
+} // namespace
+
+// Writes `samples` (interleaved) as a WAV: integer PCM or IEEE float, at
+// the sample type's width.
+template <typename Sample>
+bool writeWav(const std::string &path, int numChannels, uint32_t sampleRate,
+              const std::vector<Sample> &samples) {
+  std::FILE *out = std::fopen(path.c_str(), "wb");
+  if (out == nullptr) {
+    return false;
+  }
+  const uint16_t bits = 8 * sizeof(Sample);
+  const uint32_t blockAlign = numChannels * sizeof(Sample);
+  const uint32_t dataSize =
+      static_cast<uint32_t>(samples.size() * sizeof(Sample));
+  auto u32 = [out](uint32_t v) { std::fwrite(&v, 4, 1, out); };
+  auto u16 = [out](uint16_t v) { std::fwrite(&v, 2, 1, out); };
+  std::fwrite("RIFF", 1, 4, out);
+  u32(36 + dataSize);
+  std::fwrite("WAVEfmt ", 1, 8, out);
+  u32(16);
+  u16(std::is_floating_point_v<Sample> ? 3 : 1); // IEEE float or PCM
+  u16(numChannels);
+  u32(sampleRate);
+  u32(sampleRate * blockAlign);
+  u16(blockAlign);
+  u16(bits);
+  std::fwrite("data", 1, 4, out);
+  u32(dataSize);
+  std::fwrite(samples.data(), sizeof(Sample), samples.size(), out);
+  return std::fclose(out) == 0;
+}
+
+std::string tempWavPath() {
+  return (std::filesystem::temp_directory_path() /
+          ("kernel_check_" + std::to_string(::getpid()) + ".wav"))
+      .string();
+}
+
+// WavReader::readSumSquares() on int32 and float32 files against sums of the
+// samples as written: mono (read in place), stereo and 5.1 (one channel at a
+// time), over more than one 2^16-sample chunk and from an odd start frame.
+void checkWavSumSquares(Checker &checker) {
+  const size_t numFrames = 70001;
+  const std::string path = tempWavPath();
+  std::minstd_rand rng(4);
+  auto check = [&](const std::string &what, int numChannels,
+                   const std::vector<double> &values, bool written) {
+    if (!written) {
+      checker.expect(false, what + ": could not write " + path);
+      return;
+    }
+    WavReader reader(path);
+    for (size_t start : {size_t(0), size_t(3)}) {
+      const size_t count = numFrames - start - 2;
+      std::vector<double> want(numChannels, 0.0);
+      for (size_t f = start; f < start + count; ++f) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+          const double x = values[f * numChannels + ch];
+          want[ch] += x * x;
+        }
+      }
+      std::vector<double> got(numChannels, -1.0);
+      const size_t summed = reader.readSumSquares(start, count, got.data());
+      const std::string where = what + " channels=" +
+                                std::to_string(numChannels) + " start=" +
+                                std::to_string(start);
+      checker.expect(summed == count, where + " count");
+      for (int ch = 0; ch < numChannels; ++ch) {
+        checker.expect(Checker::near(got[ch], want[ch], 1e-12),
+                       where + " ch" + std::to_string(ch));
+      }
+    }
+  };
+  for (int numChannels : {1, 2, 6}) {
+    std::vector<int32_t> ints(numFrames * numChannels);
+    std::vector<float> floats(numFrames * numChannels);
+    std::vector<double> intValues(ints.size()), floatValues(floats.size());
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    for (size_t i = 0; i < ints.size(); ++i) {
+      ints[i] = static_cast<int32_t>(rng() << 1);
+      intValues[i] = std::ldexp(static_cast<double>(ints[i]), -31);
+      floats[i] = dist(rng);
+      floatValues[i] = floats[i];
+    }
+    check("wav_sum_squares int32", numChannels, intValues,
+          writeWav(path, numChannels, 48000, ints));
+    check("wav_sum_squares float32", numChannels, floatValues,
+          writeWav(path, numChannels, 48000, floats));
+  }
+  std::remove(path.c_str());
+}
+
+// A 3 s stereo track whose 240-sample bins come to an odd count (603, the
+// last one partial), so the pyramid carries odd bins up. sumBins() must match
+// a brute-force sum over random ranges, and with an epoch of 6 bins,
+// envelope() must match analyzeRange() epoch for epoch.
+void checkLoudnessPyramid(Checker &checker) {
+  const int kNumChannels = 2;
+  const uint32_t kSampleRate = 48000;
+  const size_t kHop = 240;
+  const float kEpoch_s = 0.03f; // 1440 samples.
+  const size_t numFrames = 1440 * 100 + 500;
+  std::vector<int16_t> samples(numFrames * kNumChannels);
+  std::minstd_rand rng(5);
+  std::uniform_int_distribution<int> dist(-32768, 32767);
+  for (int16_t &v : samples) {
+    v = static_cast<int16_t>(dist(rng));
+  }
+  const std::string path = tempWavPath();
+  if (!writeWav(path, kNumChannels, kSampleRate, samples)) {
+    checker.expect(false, "pyramid: could not write " + path);
+    return;
+  }
+
+  LoudnessPyramid pyramid;
+  checker.expect(pyramid.build(path, kHop, 3), "pyramid: build");
+  const size_t numBins = (numFrames + kHop - 1) / kHop;
+  checker.expect(!pyramid.isEmpty() && pyramid.getNumBins(0) == numBins &&
+                     numBins % 2 == 1,
+                 "pyramid: " + std::to_string(numBins) + " base bins");
+
+  if (!pyramid.isEmpty()) {
+    std::vector<std::pair<size_t, size_t>> ranges = {
+        {0, numBins},     {0, 1},           {numBins - 1, numBins},
+        {1, numBins - 1}, {0, numBins + 7}, {5, 5},
+    };
+    std::uniform_int_distribution<size_t> bin(0, numBins);
+    for (int i = 0; i < 500; ++i) {
+      const size_t a = bin(rng), b = bin(rng);
+      ranges.emplace_back(std::min(a, b), std::max(a, b) + (i % 3 == 0));
+    }
+    for (const auto &[first, end] : ranges) {
+      const size_t lo = first * kHop;
+      const size_t hi = std::min(end * kHop, numFrames);
+      double want[kNumChannels] = {};
+      for (size_t f = lo; f < hi; ++f) {
+        for (int ch = 0; ch < kNumChannels; ++ch) {
+          const double x = samples[f * kNumChannels + ch] / 32768.0;
+          want[ch] += x * x;
+        }
+      }
+      double got[kNumChannels];
+      const size_t count = pyramid.sumBins(first, end, got);
+      const std::string what = "pyramid_sum_bins [" + std::to_string(first) +
+                               ", " + std::to_string(end) + ")";
+      checker.expect(count == (hi > lo ? hi - lo : 0), what + " count");
+      for (int ch = 0; ch < kNumChannels; ++ch) {
+        checker.expect(Checker::near(got[ch], want[ch], 1e-12),
+                       what + " ch" + std::to_string(ch));
+      }
+    }
+  }
+
+  LoudnessGenerator generator(path, kEpoch_s);
+  const LoudnessEnvelope want = generator.analyzeRange();
+  const LoudnessEnvelope got =
+      pyramid.envelope(0.f, generator.getLength_s(), kEpoch_s);
+  checker.expect(got.size() == want.size() && want.size() == 101,
+                 "pyramid_envelope: " + std::to_string(got.size()) +
+                     " epochs, analyzeRange " + std::to_string(want.size()));
+  const size_t stride = want.getRecordStride();
+  for (size_t e = 0; e < std::min(got.size(), want.size()); ++e) {
+    const float *g = got.records.data() + e * stride;
+    const float *w = want.records.data() + e * stride;
+    const std::string what = "pyramid_envelope epoch " + std::to_string(e);
+    checker.expect(Checker::near(g[0], w[0], 0.0, 1e-6), what + " time");
+    for (int ch = 0; ch < kNumChannels; ++ch) {
+      checker.expect(Checker::near(g[1 + ch], w[1 + ch], 1e-5),
+                     what + " ch" + std::to_string(ch));
+    }
+  }
+  std::remove(path.c_str());
+  std::remove(EnvelopeCache::sidecarPath(path).c_str());
+}
+
+int main() {
+  std::cout << "sum_squares: " << sumSquaresKernel().name
+            << ", pcm16: " << pcmInt16Kernel().name
+            << ", pcm24: " << pcmInt24Kernel().name
+            << ", pcm32: " << pcmInt32Kernel().name
+            << ", k_weighting: " << kWeightKernel().name
+            << ", displace: " << displaceKernel().name << "\n";
+  Checker checker;
+  checkSumSquares(checker);
+  checkPcmSumSquares(checker);
+  checkPcmSumSquaresInt32(checker);
+  checkKWeighting(checker);
+  checkDisplacement(checker);
+  checkWavSumSquares(checker);
+  checkLoudnessPyramid(checker);
+  return checker.summary();
+}
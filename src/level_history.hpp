@@ -0,0 +1,238 @@
+#ifndef LEVEL_HISTORY_H
+#define LEVEL_HISTORY_H
+
+#include "speaker_points/speaker_dbs.hpp"
+#include "texture_buffer.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Per-speaker levels of a window of consecutive epochs, so the renderer can
+// interpolate between epochs at the frame's exact time instead of stepping
+// once per epoch. Epoch k (the one starting at k * period) lives in slot
+// k % depth of a vec4 texture buffer, one texel per speaker: x broadband,
+// yzw low / mid / high band, as in the old per-epoch levels. room.vs reads
+// it directly; the CPU displacement path calls sample().
+//
+// Epochs arrive ahead of time in batches: once less than half the ring is
+// filled ahead of the clock, needsRefill() asks for everything up to
+// getHorizon_s(), and flush() sends the batch up in one buffer update (two
+// when it wraps the ring).
+class LevelHistory {
+public:
+  enum Interpolation { Step, Linear, Cubic };
+  static constexpr size_t kDefaultDepth = 64;
+
+  static bool parseInterpolation(const std::string &name, Interpolation &out) {
+    if (name == "step") {
+      out = Step;
+    } else if (name == "linear") {
+      out = Linear;
+    } else if (name == "cubic") {
+      out = Cubic;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  explicit LevelHistory(size_t depth = kDefaultDepth)
+      : kDepth(std::max<size_t>(depth, 4)), texels(GL_RGBA32F) {}
+  // Must run while the GL context is still current.
+  void destroy() { texels.destroy(); }
+
+  LevelHistory(const LevelHistory &) = delete;
+  LevelHistory &operator=(const LevelHistory &) = delete;
+
+  size_t getDepth() const { return kDepth; }
+  float getPeriod_s() const { return period_s; }
+  // Resident epochs, first to last inclusive; last < first when empty.
+  long getFirst() const { return first; }
+  long getLast() const { return last; }
+
+  // Drops every epoch and sizes the ring for `numSpkrs` speakers.
+  void reset(size_t numSpkrs) {
+    this->numSpkrs = numSpkrs;
+    levels.assign(kDepth * numSpkrs, glm::vec4(0.f));
+    texels.upload(levels.data(), levels.size() * sizeof(glm::vec4),
+                  GL_DYNAMIC_DRAW);
+    first = 0;
+    last = -1;
+    dirtyFirst = 0;
+    dirtyLast = -1;
+  }
+
+  // Spacing of epoch timestamps (LoudnessGenerator::getEpochPeriod_s()).
+  // Drops every epoch.
+  void setPeriod(float period) {
+    period_s = period;
+    reset(numSpkrs);
+  }
+
+  // Less than half the ring is filled ahead of `time`.
+  bool needsRefill(float time) const {
+    return last < first || last < keepFrom(time) + long(kDepth / 2);
+  }
+
+  // Epochs starting before this fit in the ring without evicting any that
+  // interpolation at `time` still reads.
+  float getHorizon_s(float time) const {
+    return static_cast<float>((keepFrom(time) + long(kDepth)) * period_s);
+  }
+  // Start of the oldest epoch interpolation at `time` reads; a feed that
+  // jumps ahead can begin here rather than at the start of the track.
+  float getWindowStart_s(float time) const {
+    return static_cast<float>(std::max(keepFrom(time), 0l) * period_s);
+  }
+
+  // Stores an epoch's broadband and (up to three) band levels. Channels past
+  // the last speaker are ignored. An epoch that doesn't follow the newest
+  // one, e.g. after the producer skipped ahead, restarts the window. Returns
+  // false for an epoch that is too old or beyond the horizon.
+  bool add(const LoudnessEpoch &epoch, int numBands, float time) {
+    if (epoch.timeStamp < 0 || !(period_s > 0.f)) {
+      return false;
+    }
+    const long k = std::lround(epoch.timeStamp / period_s);
+    if (last < first || k > last + 1) {
+      first = last = k;
+      dirtyFirst = dirtyLast = k;
+    } else if (k < first) {
+      return false;
+    } else if (k > last) {
+      if (k - first >= long(kDepth)) {
+        if (k - long(kDepth) + 1 > keepFrom(time)) {
+          return false;
+        }
+        first = k - long(kDepth) + 1;
+      }
+      last = k;
+    }
+    if (dirtyLast < dirtyFirst) {
+      dirtyFirst = dirtyLast = k;
+    } else {
+      dirtyFirst = std::min(dirtyFirst, k);
+      dirtyLast = std::max(dirtyLast, k);
+    }
+
+    glm::vec4 *slot = &levels[slotOf(k) * numSpkrs];
+    const size_t n = std::min(epoch.speakerDbs.size(), numSpkrs);
+    for (size_t i = 0; i < n; ++i) {
+      slot[i] = glm::vec4(epoch.speakerDbs[i], 0.f, 0.f, 0.f);
+      for (int b = 0; b < std::min(numBands, 3); ++b) {
+        slot[i][1 + b] = epoch.bandDbs[i * numBands + b];
+      }
+    }
+    return true;
+  }
+
+  // Uploads every slot add() wrote since the last flush.
+  void flush() {
+    dirtyFirst = std::max(dirtyFirst, first);
+    dirtyLast = std::min(dirtyLast, last);
+    if (dirtyLast < dirtyFirst) {
+      return;
+    }
+    // The dirty epochs are contiguous, so at most two runs of slots.
+    size_t slot = slotOf(dirtyFirst);
+    size_t remaining = dirtyLast - dirtyFirst + 1;
+    while (remaining > 0) {
+      const size_t run = std::min(remaining, kDepth - slot);
+      texels.update(slot * numSpkrs * sizeof(glm::vec4),
+                    &levels[slot * numSpkrs],
+                    run * numSpkrs * sizeof(glm::vec4));
+      remaining -= run;
+      slot = 0;
+    }
+    dirtyFirst = 0;
+    dirtyLast = -1;
+  }
+
+  void bind(GLuint unit) const { texels.bind(unit); }
+
+  // Start time of the newest resident epoch that has begun by `time`, or -1.
+  float getEpochTimeAt(float time) const {
+    if (last < first || !(period_s > 0.f)) {
+      return -1.f;
+    }
+    const long k = std::min(long(std::floor(time / period_s)), last);
+    return k < first ? -1.f : static_cast<float>(k * period_s);
+  }
+
+  // The levels room.vs computes at `time`, one per speaker; all zero while
+  // nothing is resident.
+  void sample(float time, Interpolation interpolation,
+              std::vector<glm::vec4> &out) const {
+    out.assign(numSpkrs, glm::vec4(0.f));
+    if (last < first || !(period_s > 0.f)) {
+      return;
+    }
+    if (interpolation == Step) {
+      const long k = long(std::floor(time / period_s));
+      for (size_t s = 0; s < numSpkrs; ++s) {
+        out[s] = at(k, s);
+      }
+      return;
+    }
+    // Each epoch is keyed at the middle of its window.
+    const float pos = time / period_s - 0.5f;
+    const long k = long(std::floor(pos));
+    const float t = pos - static_cast<float>(k);
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      if (interpolation == Linear) {
+        out[s] = glm::mix(at(k, s), at(k + 1, s), t);
+        continue;
+      }
+      const glm::vec4 p0 = at(k - 1, s), p1 = at(k, s), p2 = at(k + 1, s),
+                      p3 = at(k + 2, s);
+      out[s] = glm::clamp(catmullRom(p0, p1, p2, p3, t),
+                          glm::min(glm::min(p0, p1), glm::min(p2, p3)),
+                          glm::max(glm::max(p0, p1), glm::max(p2, p3)));
+    }
+  }
+
+  // Catmull-Rom through p1 (t = 0) and p2 (t = 1); room.vs has the same.
+  static glm::vec4 catmullRom(const glm::vec4 &p0, const glm::vec4 &p1,
+                              const glm::vec4 &p2, const glm::vec4 &p3,
+                              float t) {
+    return 0.5f * (2.f * p1 + (p2 - p0) * t +
+                   (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t * t +
+                   (3.f * (p1 - p2) + p3 - p0) * t * t * t);
+  }
+
+private:
+  // Oldest epoch interpolation at `time` can read: the cubic's first key.
+  long keepFrom(float time) const {
+    if (!(period_s > 0.f)) {
+      return 0;
+    }
+    return long(std::floor(time / period_s - 0.5f)) - 1;
+  }
+
+  size_t slotOf(long k) const {
+    return static_cast<size_t>(k) % kDepth;
+  }
+
+  // Epochs outside the window read as the nearest resident one.
+  const glm::vec4 &at(long k, size_t spkr) const {
+    k = std::clamp(k, first, last);
+    return levels[slotOf(k) * numSpkrs + spkr];
+  }
+
+  const size_t kDepth;
+  size_t numSpkrs = 0;
+  float period_s = 0.f;
+  long first = 0;
+  long last = -1;
+  long dirtyFirst = 0;
+  long dirtyLast = -1;
+  std::vector<glm::vec4> levels;
+  TextureBuffer texels;
+};
+
+#endif
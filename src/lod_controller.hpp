@@ -0,0 +1,92 @@
+#ifndef LOD_CONTROLLER_H
+#define LOD_CONTROLLER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Picks a level of detail that keeps frame cost within a budget. A level
+// that has been measured is predicted to cost what it last did; otherwise
+// cost is assumed proportional to the level's element count. Whole frames
+// carry a fixed cost on top, so the proportional guess is pessimistic for
+// finer levels and optimistic for coarser ones, and the measurements take
+// over once the controller has visited them.
+//
+// Switching is damped three ways: costs are smoothed over several frames, a
+// level only changes after kSettleFrames consecutive frames agree, and
+// stepping up requires the *predicted* cost of the finer level to sit below
+// kUpHeadroom of the budget, so a level that just fits is never abandoned
+// for one that would immediately overrun.
+class LodController {
+public:
+  static constexpr double kSmoothing = 0.1;  // EMA weight of a new sample.
+  static constexpr double kUpHeadroom = 0.7; // Of the budget, for step-ups.
+  static constexpr int kSettleFrames = 10;
+  static constexpr int kHoldFrames = 30; // Settling time after a switch.
+
+  // `counts` are the element counts per level, coarsest first.
+  LodController(std::vector<size_t> counts, size_t startLevel, double budget_ms)
+      : kCounts(std::move(counts)), kBudget_ms(budget_ms),
+        level(std::min(startLevel, kCounts.size() - 1)),
+        measured_ms(kCounts.size(), 0.0) {}
+
+  size_t getLevel() const { return level; }
+  double getSmoothedCost_ms() const { return smoothed_ms; }
+
+  // Feeds one frame's measured cost. Returns true when the level changed.
+  bool update(double cost_ms) {
+    smoothed_ms = haveSample
+                      ? smoothed_ms + kSmoothing * (cost_ms - smoothed_ms)
+                      : cost_ms;
+    haveSample = true;
+    measured_ms[level] = smoothed_ms;
+    if (hold > 0) {
+      --hold;
+      return false;
+    }
+
+    int direction = 0;
+    if (smoothed_ms > kBudget_ms && level > 0) {
+      direction = -1;
+    } else if (level + 1 < kCounts.size() &&
+               predict(level + 1) < kUpHeadroom * kBudget_ms) {
+      direction = 1;
+    }
+    streak = direction != 0 && direction == streakDirection ? streak + 1 : 1;
+    streakDirection = direction;
+    if (direction == 0 || streak < kSettleFrames) {
+      return false;
+    }
+
+    // Rescale the estimate so the new level starts from a sensible guess
+    // instead of the old level's cost.
+    smoothed_ms = predict(level + direction);
+    level += direction;
+    hold = kHoldFrames;
+    streak = 0;
+    streakDirection = 0;
+    return true;
+  }
+
+private:
+  double predict(size_t toLevel) const {
+    if (measured_ms[toLevel] > 0.0) {
+      return measured_ms[toLevel];
+    }
+    return smoothed_ms * static_cast<double>(kCounts[toLevel]) /
+           static_cast<double>(kCounts[level]);
+  }
+
+  const std::vector<size_t> kCounts;
+  const double kBudget_ms;
+  size_t level;
+  std::vector<double> measured_ms; // Last smoothed cost per level, 0 if none.
+  double smoothed_ms = 0.0;
+  bool haveSample = false;
+  int hold = 0;
+  int streak = 0;
+  int streakDirection = 0;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Command-line options for the window target.
+//
+//   window [options] [audio.wav]
+//     --sink <spec>           null | file:<path> | pipe:<command> | auto
+//     --audio-latency-ms <n>  output latency the playback clock subtracts
+//     --size <W>x<H>          framebuffer size
+//     --shader-dir <dir>      read the room and wall shaders from <dir>
+//                             instead of the copies built into the binary
+//     --program-cache <dir>   where linked program binaries are kept
+//                             (default: $XDG_CACHE_HOME/joelgl/programs)
+//     --no-program-cache      always compile shaders from source
+//     --room-texture <path>   image on the room walls ("" for no walls);
+//                             mipmaps are cached next to it as <path>.mips
+//     --points <n>            number of points on the sphere (the starting
+//                             level when --frame-budget-ms is set)
+//     --frame-budget-ms <ms>  pick the point count so a whole frame (its CPU
+//                             work, or its GPU time if longer) fits in this
+//                             many ms (0: fixed --points)
+//     --lod-min-points <n>    coarsest level of the point count chain
+//     --lod-max-points <n>    densest level of the point count chain
+//     --cpu-displacement      displace on the CPU instead of in room.vs
+//     --views <list>          comma-separated cameras tiled over the frame:
+//                             side, top, back, iso (default: back)
+//     --sinc-lut-resolution <n>  sinc table samples per unit argument
+//     --level-interp <mode>   step | linear | cubic: how speaker levels move
+//                             between analysis epochs (default: linear)
+//     --loudness <mode>       rms | lufs: speakers follow per-band RMS levels
+//                             or momentary BS.1770 loudness (default: rms)
+//     --layout <name|file>    speaker layout: mono, stereo, 3.0, quad, 5.1,
+//                             7.1, 7.1.4, 22.2 or a layout file (default:
+//                             chosen by the track's channel count)
+//     --profile <file>        record per-frame CPU/GPU timings and epoch lag;
+//                             <file>.csv gets CSV, anything else a Chrome
+//                             trace. Percentiles print on exit.
+//   Offline rendering (frames go to stdout, logs to stderr):
+//     --headless              render through EGL without a window
+//     --fps <n>               frames per second of audio time
+//     --format <rgb|y4m>      raw RGB24 or YUV4MPEG2 4:4:4
+//     --frames <n>            stop after n frames (default: whole track)
+//     --pbo-count <n>         depth of the readback ring
+//     --shards <n>            render in n processes (0: one per core)
+struct RunOptions {
+  std::string audioPath =
+      "resources/audio/Mau P - Gimme That Bounce (Official Video).wav";
+  std::string sink = "auto";
+  float audioLatency_s = 0.1f;
+  int width = 720;
+  int height = 546;
+  std::string shaderDir; // Empty: the embedded shaders.
+  std::string programCacheDir; // Empty: ProgramBinaryCache::defaultDir().
+  bool programCache = true;
+  std::string roomTexturePath = "resources/textures/RoomTexture3.png";
+  int numPoints = 2048;
+  float frameBudget_ms = 0.f;
+  int lodMinPoints = 512;
+  int lodMaxPoints = 512 * 1024;
+  bool cpuDisplacement = false;
+  std::string views = "back";
+  float sincLutResolution = 32.f;
+  std::string levelInterpolation = "linear";
+  std::string loudness = "rms";
+  std::string layout;
+  std::string profilePath;
+  bool headless = false;
+  int fps = 60;
+  std::string format = "y4m";
+  long maxFrames = -1;
+  int pboCount = 3;
+  int shards = 1;
+};
+
+inline RunOptions parseOptions(int argc, char **argv) {
+  RunOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--sink" && hasValue) {
+      options.sink = argv[++i];
+    } else if (arg == "--audio-latency-ms" && hasValue) {
+      options.audioLatency_s = std::atof(argv[++i]) / 1000.f;
+    } else if (arg == "--size" && hasValue) {
+      const std::string size = argv[++i];
+      const size_t x = size.find('x');
+      if (x != std::string::npos) {
+        options.width = std::max(1, std::atoi(size.c_str()));
+        options.height = std::max(1, std::atoi(size.c_str() + x + 1));
+      }
+    } else if (arg == "--shader-dir" && hasValue) {
+      options.shaderDir = argv[++i];
+    } else if (arg == "--program-cache" && hasValue) {
+      options.programCacheDir = argv[++i];
+    } else if (arg == "--no-program-cache") {
+      options.programCache = false;
+    } else if (arg == "--room-texture" && hasValue) {
+      options.roomTexturePath = argv[++i];
+    } else if (arg == "--points" && hasValue) {
+      options.numPoints = std::max(2, std::atoi(argv[++i]));
+    } else if (arg == "--frame-budget-ms" && hasValue) {
+      options.frameBudget_ms = std::max(0.f, (float)std::atof(argv[++i]));
+    } else if (arg == "--lod-min-points" && hasValue) {
+      options.lodMinPoints = std::max(2, std::atoi(argv[++i]));
+    } else if (arg == "--lod-max-points" && hasValue) {
+      options.lodMaxPoints = std::max(2, std::atoi(argv[++i]));
+    } else if (arg == "--cpu-displacement") {
+      options.cpuDisplacement = true;
+    } else if (arg == "--views" && hasValue) {
+      options.views = argv[++i];
+    } else if (arg == "--sinc-lut-resolution" && hasValue) {
+      options.sincLutResolution = std::max(1.f, (float)std::atof(argv[++i]));
+    } else if (arg == "--level-interp" && hasValue) {
+      options.levelInterpolation = argv[++i];
+    } else if (arg == "--loudness" && hasValue) {
+      options.loudness = argv[++i];
+    } else if (arg == "--layout" && hasValue) {
+      options.layout = argv[++i];
+    } else if (arg == "--profile" && hasValue) {
+      options.profilePath = argv[++i];
+    } else if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--fps" && hasValue) {
+      options.fps = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--format" && hasValue) {
+      options.format = argv[++i];
+    } else if (arg == "--frames" && hasValue) {
+      options.maxFrames = std::atol(argv[++i]);
+    } else if (arg == "--pbo-count" && hasValue) {
+      options.pboCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--shards" && hasValue) {
+      options.shards = std::max(0, std::atoi(argv[++i]));
+      if (options.shards == 0) {
+        options.shards = std::max(1u, std::thread::hardware_concurrency());
+      }
+    } else if (arg.rfind("--", 0) == 0) {
+      std::cout << "Ignoring unknown option " << arg << "\n";
+    } else {
+      options.audioPath = arg;
+    }
+  }
+  return options;
+}
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include "speaker_points/envelope_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// glad is generated for core 3.3, which predates program binaries (core in
+// 4.1, or ARB_get_program_binary), so their entry points and enums are
+// declared here and loaded by loadProgramBinaryApi() through the same loader
+// glad used.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+struct ProgramBinaryApi {
+  typedef void(APIENTRYP GetProgramBinaryFn)(GLuint, GLsizei, GLsizei *,
+                                              GLenum *, void *);
+  typedef void(APIENTRYP ProgramBinaryFn)(GLuint, GLenum, const void *,
+                                           GLsizei);
+  typedef void(APIENTRYP ProgramParameteriFn)(GLuint, GLenum, GLint);
+
+  GetProgramBinaryFn getProgramBinary = nullptr;
+  ProgramBinaryFn programBinary = nullptr;
+  ProgramParameteriFn programParameteri = nullptr;
+  // Entry points loaded and the driver offers at least one binary format.
+  bool available = false;
+};
+
+inline ProgramBinaryApi &programBinaryApi() {
+  static ProgramBinaryApi api;
+  return api;
+}
+
+// Call once after gladLoadGLLoader(), with the same loader and the context
+// current. Leaves the API unavailable on drivers without program binaries.
+inline void loadProgramBinaryApi(GLADloadproc load) {
+  ProgramBinaryApi &api = programBinaryApi();
+  api = {};
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  bool supported = major > 4 || (major == 4 && minor >= 1);
+  GLint numExtensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (GLint i = 0; i < numExtensions && !supported; ++i) {
+    const char *ext =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    supported = ext != nullptr &&
+                std::strcmp(ext, "GL_ARB_get_program_binary") == 0;
+  }
+  if (!supported) {
+    return;
+  }
+  api.getProgramBinary =
+      (ProgramBinaryApi::GetProgramBinaryFn)load("glGetProgramBinary");
+  api.programBinary = (ProgramBinaryApi::ProgramBinaryFn)load("glProgramBinary");
+  api.programParameteri =
+      (ProgramBinaryApi::ProgramParameteriFn)load("glProgramParameteri");
+  GLint numFormats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  api.available = api.getProgramBinary != nullptr &&
+                  api.programBinary != nullptr &&
+                  api.programParameteri != nullptr && numFormats > 0;
+}
+
+// Linked programs saved with glGetProgramBinary, one file per program, keyed
+// by the final shader sources and the driver. A binary is only handed back
+// when the GL_VENDOR / GL_RENDERER / GL_VERSION strings it was saved under
+// match the running driver and glProgramBinary() links it; in every other
+// case load() misses and the caller compiles from source and calls store().
+//
+// Files are written through replaceFile(), like the envelope sidecar, so
+// processes storing the same program at once don't mix their bytes; failing
+// to write one is not an error.
+class ProgramBinaryCache {
+public:
+  static constexpr char kMagic[8] = {'S', 'A', 'P', 'R', 'G', '0', '0', '1'};
+
+  struct Header {
+    char magic[8];
+    uint32_t headerSize;
+    uint32_t format;
+    uint64_t driverHash;
+    uint64_t sourceHash;
+    uint64_t length;
+  };
+
+  // $XDG_CACHE_HOME/joelgl/programs, else ~/.cache/joelgl/programs, else
+  // empty (no cache).
+  static std::string defaultDir() {
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+      return std::string(xdg) + "/joelgl/programs";
+    }
+    if (const char *home = std::getenv("HOME"); home && *home) {
+      return std::string(home) + "/.cache/joelgl/programs";
+    }
+    return "";
+  }
+
+  // An empty `dir`, or a driver without program binaries, disables the cache.
+  // Needs a current context.
+  explicit ProgramBinaryCache(std::string dir) : kDir(std::move(dir)) {
+    enabled = !kDir.empty() && programBinaryApi().available;
+    if (enabled) {
+      std::string driver;
+      for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const GLubyte *value = glGetString(name);
+        driver += value ? reinterpret_cast<const char *>(value) : "";
+        driver += '\n';
+      }
+      driverHash = hashBytes(driver.data(), driver.size());
+    }
+  }
+
+  ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+  ProgramBinaryCache &operator=(const ProgramBinaryCache &) = delete;
+
+  bool isEnabled() const { return enabled; }
+
+  // A linked program for these sources, or 0 on a miss.
+  GLuint load(const std::string &vertexCode, const std::string &fragmentCode) {
+    if (!enabled) {
+      return 0;
+    }
+    const uint64_t sourceHash = hashSources(vertexCode, fragmentCode);
+    std::FILE *f = std::fopen(path(sourceHash).c_str(), "rb");
+    if (f == nullptr) {
+      return 0;
+    }
+    Header h;
+    std::vector<uint8_t> binary;
+    bool ok = std::fread(&h, sizeof(h), 1, f) == 1 &&
+              std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 &&
+              h.headerSize == sizeof(Header) && h.driverHash == driverHash &&
+              h.sourceHash == sourceHash && h.length > 0 &&
+              h.length < (1u << 30);
+    if (ok) {
+      binary.resize(h.length);
+      ok = std::fread(binary.data(), 1, binary.size(), f) == binary.size();
+    }
+    std::fclose(f);
+    if (!ok) {
+      return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    programBinaryApi().programBinary(program, h.format, binary.data(),
+                                     static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+      // E.g. a driver update that kept its version string; recompile.
+      glDeleteProgram(program);
+      return 0;
+    }
+    return program;
+  }
+
+  // Saves `program`, which was linked from these sources.
+  bool store(GLuint program, const std::string &vertexCode,
+             const std::string &fragmentCode) {
+    if (!enabled) {
+      return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+      return false;
+    }
+    std::vector<uint8_t> binary(length);
+    GLenum format = 0;
+    programBinaryApi().getProgramBinary(program, length, &length, &format,
+                                        binary.data());
+    Header h = {};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.headerSize = sizeof(Header);
+    h.format = format;
+    h.driverHash = driverHash;
+    h.sourceHash = hashSources(vertexCode, fragmentCode);
+    h.length = static_cast<uint64_t>(length);
+
+    std::error_code error;
+    std::filesystem::create_directories(kDir, error);
+    return replaceFile(path(h.sourceHash), [&](FILE *f) {
+      return std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+             std::fwrite(binary.data(), 1, h.length, f) == h.length;
+    });
+  }
+
+private:
+  // 64-bit FNV-1a, as for the envelope sidecar.
+  static uint64_t hashBytes(const void *data, size_t size,
+                            uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  static uint64_t hashSources(const std::string &vertexCode,
+                              const std::string &fragmentCode) {
+    // The terminator keeps ("ab", "c") and ("a", "bc") apart.
+    const uint64_t hash = hashBytes(vertexCode.c_str(), vertexCode.size() + 1);
+    return hashBytes(fragmentCode.data(), fragmentCode.size(), hash);
+  }
+
+  // One file per (driver, sources) pair, so switching GPUs doesn't evict.
+  std::string path(uint64_t sourceHash) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "/%016llx%016llx.bin",
+                  static_cast<unsigned long long>(driverHash),
+                  static_cast<unsigned long long>(sourceHash));
+    return kDir + name;
+  }
+
+  const std::string kDir;
+  bool enabled = false;
+  uint64_t driverHash = 0;
+};
+
+#endif
@@ -6,49 +6,40 @@
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/trigonometric.hpp"
 #include <GLFW/glfw3.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "shader_m.h"
+#ifdef HAVE_EGL
+#include "headless.hpp"
+#endif
+#include "frame_profiler.hpp"
+#include "options.hpp"
+#include "room.hpp"
+#include "speaker_points/audio_player.hpp"
+#include "speaker_points/epoch_producer.hpp"
 #include "speaker_points/speaker_dbs.hpp"
-#include "speaker_points/speaker_points.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+// After every header that includes stb_image.h for its declarations.
+#define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include <chrono>
 #include <iostream>
 
-// settings
-const unsigned int SCR_WIDTH = 720;
-const unsigned int SCR_HEIGHT = 546;
-
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void processInput(GLFWwindow *window);
-void glParams() {
-  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-  // Enable depth test
-  // glEnable(GL_DEPTH_TEST);
 
-  // // Accept fragment if it closer to the camera than the former one
-  // glDepthFunc(GL_LESS);
-}
-void setMVP(const Shader shader) {
-  glm::mat4 model, view, projection;
-  model = view = projection = glm::mat4(1.0f);
-
-  view = glm::translate(view, glm::vec3(0.0f, 0.0f, -5.0f));
-
-  // Constant.
-  projection = glm::perspective(
-      glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-
-  // We set these uniforms once as our view is constant for now.
-  shader.setMat4("u_model", model);
-  shader.setMat4("u_view", view);
-  shader.setMat4("u_projection", projection);
-}
+int main(int argc, char **argv) {
+  const auto launch = std::chrono::steady_clock::now();
+  const RunOptions options = parseOptions(argc, argv);
+  if (options.headless) {
+#ifdef HAVE_EGL
+    return runHeadless(options);
+#else
+    std::cout << "ERROR::HEADLESS::UNSUPPORTED: built without EGL" << std::endl;
+    return -1;
+#endif
+  }
 
-int main() {
   // glfw: initialize and configure
   // ------------------------------
   glfwInit();
@@ -63,7 +54,7 @@ int main() {
   // glfw window creation
   // --------------------
   GLFWwindow *window =
-      glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "GLProgram", NULL, NULL);
+      glfwCreateWindow(options.width, options.height, "GLProgram", NULL, NULL);
   if (window == NULL) {
     std::cout << "Failed to create GLFW window" << std::endl;
     glfwTerminate();
@@ -78,96 +69,58 @@ int main() {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
-
-  // build and compile our shader zprogram
-  // ------------------------------------
-  Shader ourShader("/Users/joelm/Desktop/joelgl 2/src/room.vs",
-                   "/Users/joelm/Desktop/joelgl 2/src/room.fs");
-  std::cout << "Built shaders\n";
-
-  // Calculate speaker uniform source positions
-  const std::vector<glm::vec3> spkrPos = {
-      sphericalToCartesian(1.f, 30.f, 0.f),
-      sphericalToCartesian(1.f, -30.f, 0.f),
-      // sphericalToCartesian(1.f, 0.f, 0.f)
-  };
-  // Calculate speaker loudnesses
-  std::vector<float> spkrDb = {
-      1.f, .3f,
-      // .5f,
+  loadProgramBinaryApi((GLADloadproc)glfwGetProcAddress);
+
+  // build and compile our shader zprogram, geometry and uniforms
+  // ------------------------------------------------------------
+  // The track's channel count picks (or checks) the speaker layout.
+  LoudnessGenerator loudnessGenerator = Room::makeLoudnessGenerator(options);
+  const SpeakerLayout layout = SpeakerLayout::resolve(
+      options.layout, loudnessGenerator.getNumChannels());
+  loudnessGenerator.setChannelWeights(layout.getLoudnessWeights());
+  Room room(options, layout);
+  const std::chrono::duration<double, std::milli> initTime =
+      std::chrono::steady_clock::now() - launch;
+  std::cout << "Finished init in " << initTime.count() << " ms\n";
+
+  const int numBands = loudnessGenerator.getNumBands();
+  room.setUseBands(numBands == 3);
+  room.setEpochPeriod(loudnessGenerator.getEpochPeriod_s());
+
+  // Analysis runs on its own thread; the loop below picks up epochs ahead of
+  // time, a batch whenever the room's history runs low.
+  EpochProducer epochProducer(loudnessGenerator);
+  auto addEpoch = [&room, numBands](const LoudnessEpoch &epoch) {
+    room.addEpoch(epoch, numBands);
   };
 
-  // set up vertex data (and buffer(s)) and configure vertex attributes
-  // ------------------------------------------------------------------
-  const int kNumPoints = 2048;
-  std::vector<glm::vec3> spherePoints =
-      generateFibonacciSpherePoints(kNumPoints);
-
-  unsigned int sphere_vert_buffer, VAO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &sphere_vert_buffer);
-
-  glBindVertexArray(VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, sphere_vert_buffer);
-  glBufferData(GL_ARRAY_BUFFER, spherePoints.size() * sizeof(glm::vec3),
-               spherePoints.data(), GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-
-  // Set constants before loop like rendering params, MVP uniforms, and activate
-  // shader.
-  glParams();
-  ourShader.use();
-  // Set uniforms
-  setMVP(ourShader);
-  ourShader.setVec3Array("u_spkrPos", spkrPos.data(), spkrPos.size());
-  ourShader.setFloatArray("u_spkrDb", spkrDb.data(), spkrDb.size());
-  // Vertex wave uniforms
-  //   const float waveSpeed = 1.0;
-  // const float maxInitialDisplacement = 0.5;
-  // const float spatialDecayRate = 10.0;
-  // const float propagationDecayRate = 1.5;
-  // const float oscillationFrequency = 10.0;
-  ourShader.setFloat("u_waveSpeed", 1);
-  ourShader.setFloat("u_maxOverallDisplacement", .3);
-  ourShader.setFloat("u_spatialDecayRate", 2.0);
-  ourShader.setFloat("u_sourceDecayRate", 1.5);
-  ourShader.setFloat("u_oscillationFrequency", 2.0);
-  // Fragment uniforms
-  ourShader.setVec3("u_lightDir", glm::vec3(-1.f, 0.f, -1.f));
-  ourShader.setVec3("u_lightColor", glm::vec3(1.f, 1.f, 1.f));
-  ourShader.setVec3("u_ambientColor", glm::vec3(0.f, 1.f, 1.f));
-  ourShader.setVec3("u_baseColor", glm::vec3(0.153, 0.0936, 0.390));
-  ourShader.setVec3("u_wavePeakColor", glm::vec3(0.850, 0, 0));
-  ourShader.setFloat("u_waveColorScale", 5.f);
-  // ourShader.setFloat("u_waveColorOffset", );
-  std::cout << "Finished init\n";
-
-  const double kStartTime = glfwGetTime(); // Get the start time
-  const float kEpochTime = 0.03f;          // Perfect.
-  LoudnessGenerator loudnessGenerator(
-      "resources/audio/Mau P - Gimme That Bounce (Official Video).wav",
-      kEpochTime);
-
-  LoudnessEpoch loudnessEpoch = loudnessGenerator.nextLoudnessEpoch();
+  // Playback happens in-process; its clock (frames the sink has consumed)
+  // drives the epochs instead of wall time.
+  AudioPlayer audioPlayer(options.audioPath, options.sink,
+                          options.audioLatency_s);
+  audioPlayer.start();
+
+  // Disabled (and close to free) without --profile.
+  FrameProfiler profiler(options.profilePath);
+  room.setProfiler(profiler);
 
   // render loop
   // -----------
   while (!glfwWindowShouldClose(window)) {
-    // calculate delta time
-    double currentTime = glfwGetTime();
-    float time = static_cast<float>(currentTime - kStartTime);
-    ourShader.setFloat("u_time", time); // Set the time uniform
-
-    if (time > loudnessEpoch.timeStamp) {
-      ourShader.setFloatArray("u_spkrAmplitude",
-                              loudnessEpoch.speakerDbs.data(),
-                              loudnessEpoch.speakerDbs.size());
-      loudnessEpoch = loudnessGenerator.nextLoudnessEpoch();
+    profiler.beginFrame();
+    const auto frameStart = std::chrono::steady_clock::now();
+    // Time is what the audio sink has played so far.
+    float time = audioPlayer.time_s();
+    room.setTime(time);
+
+    {
+      FrameProfiler::Scope scope(profiler, FrameProfiler::EpochFetch);
+      if (room.needsEpochs()) {
+        epochProducer.popAhead(time, room.getEpochHorizon_s(), addEpoch);
+      }
+    }
+    if (const float shown = room.getShownEpochTime(); shown >= 0) {
+      profiler.setEpochLag((time - shown) * 1000.0);
     }
 
     // input
@@ -176,25 +129,35 @@ int main() {
 
     // render
     // ------
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    // render container
-    glBindVertexArray(VAO);
-    glPointSize(7.f);
-    glDrawArrays(GL_POINTS, 0, kNumPoints);
+    room.draw();
+    // The swap waits for vblank, so it stays out of the frame cost; the GPU
+    // side is covered by the room's timer query.
+    room.endFrame(std::chrono::steady_clock::now() - frameStart);
 
     // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved
     // etc.)
     // -------------------------------------------------------------------------------
-    glfwSwapBuffers(window);
+    {
+      FrameProfiler::Scope scope(profiler, FrameProfiler::Swap);
+      glfwSwapBuffers(window);
+    }
     glfwPollEvents();
+    profiler.endFrame();
   }
 
+  std::cout << "Epoch ring underruns: " << epochProducer.getUnderruns()
+            << ", overruns: " << epochProducer.getOverruns() << "\n";
+  const SkewStats skew = audioPlayer.getSkewStats();
+  std::cout << "A/V startup: " << skew.startup_s * 1000
+            << " ms, skew mean: " << skew.meanSkew_s * 1000
+            << " ms, max: " << skew.maxAbsSkew_s * 1000
+            << " ms, drift: " << skew.drift_ppm << " ppm\n";
+  profiler.printSummary(std::cout);
+  profiler.write();
+
   // optional: de-allocate all resources once they've outlived their purpose:
   // ------------------------------------------------------------------------
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &sphere_vert_buffer);
+  room.destroy();
 
   // glfw: terminate, clearing all previously allocated GLFW resources.
   // ------------------------------------------------------------------
@@ -7,17 +7,28 @@ in vec3 v_normal;                 // The recalculated normal vector of the displ
 // Output fragment color
 out vec4 FragColor;
 
-// --- Lighting Uniforms ---
+// --- Lighting and Material/Coloring Uniforms ---
 // Assuming a simple directional light model for this example
-uniform vec3 u_lightDir;   // Direction *to* the light source (e.g., in the same space as v_normal)
-uniform vec3 u_lightColor; // Color/intensity of the light
-uniform vec3 u_ambientColor; // Ambient light color
-
-// --- Material/Coloring Uniforms ---
-uniform vec3 u_baseColor;       // Color for areas with low or no displacement
-uniform vec3 u_wavePeakColor;   // Color for areas with high displacement (wave crests/troughs)
-uniform float u_waveColorScale; // Scales the v_displacementMagnitude to map it to the [0, 1] range for color interpolation
-uniform float u_waveColorOffset; // Optional offset for the displacement mapping
+// Per-frame parameters, shared with the vertex shader and updated with one
+// buffer upload per frame (FrameUniforms in uniform_buffer.hpp).
+layout(std140) uniform FrameParams {
+    vec4 u_lightDir;                  // xyz: direction *to* the light source
+    vec4 u_lightColor;                // xyz: color/intensity of the light
+    vec4 u_ambientColor;              // xyz: ambient light color
+    vec4 u_baseColor;                 // xyz: color for areas with low or no displacement
+    vec4 u_wavePeakColor;             // xyz: color for areas with high displacement
+    float u_time;
+    float u_waveColorScale;           // Scales v_displacementMagnitude into [0, 1] for color interpolation
+    float u_waveColorOffset;          // Optional offset for the displacement mapping
+    float u_baseSpatialFrequency;     // Base frequency of the sinc wave (controls ripple density)
+    float u_amplitudeFrequencyScale;  // How much amplitude scales the sinc wave frequency
+    float u_maxOverallDisplacement;   // Maximum possible displacement scale from all sources combined
+    float u_spatialDecayRate;         // Controls overall decay with geodesic distance from source
+    int u_useBands;                   // Drive the waves from the bands instead of the broadband amplitude
+    float u_epochPeriod;              // Seconds between epoch timestamps
+    int u_historyFirst;               // Oldest epoch in u_levelHistory
+    int u_historyLast;                // Newest epoch in u_levelHistory (< u_historyFirst: none yet)
+};
 
 void main() {
     // Use gl_PointCoord to make the points round
@@ -29,14 +40,14 @@ void main() {
     // --- Basic Lighting ---
     // Ensure the normal is normalized (should be from VS, but good practice)
     vec3 norm = normalize(v_normal);
-    vec3 lightDir = normalize(u_lightDir);
+    vec3 lightDir = normalize(u_lightDir.xyz);
 
     // Ambient component
-    vec3 ambient = u_ambientColor * u_baseColor; // Apply ambient light to the base color
+    vec3 ambient = u_ambientColor.xyz * u_baseColor.xyz; // Apply ambient light to the base color
 
     // Diffuse component (Lambertian reflectance)
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = u_lightColor * u_baseColor * diff; // Apply diffuse light to the base color
+    vec3 diffuse = u_lightColor.xyz * u_baseColor.xyz * diff; // Apply diffuse light to the base color
 
     // Combine lighting for the base surface
     vec3 baseLighting = ambient + diffuse;
@@ -48,7 +59,7 @@ void main() {
     float displacementFactor = clamp(v_displacementMagnitude * u_waveColorScale + u_waveColorOffset, 0.0, 1.0);
 
     // Interpolate between the base color and the wave peak color
-    vec3 waveColor = mix(u_baseColor, u_wavePeakColor, displacementFactor);
+    vec3 waveColor = mix(u_baseColor.xyz, u_wavePeakColor.xyz, displacementFactor);
 
     // --- Combine Lighting and Wave Coloring ---
 
@@ -57,7 +68,7 @@ void main() {
     vec3 finalColor = waveColor * baseLighting;
 
     // You could also blend the lighting results:
-    // vec3 waveLighting = u_lightColor * u_wavePeakColor * diff; // Simplified diffuse for wave peaks
+    // vec3 waveLighting = u_lightColor.xyz * u_wavePeakColor.xyz * diff; // Simplified diffuse for wave peaks
     // vec3 finalColor = mix(baseLighting, ambient + waveLighting, displacementFactor); // Mix base lighting with wave lighting
 
     FragColor = vec4(finalColor, 1.0); // Output the final color
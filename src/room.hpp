@@ -1,8 +1,567 @@
 #ifndef ROOM_H
 #define ROOM_H
 
+#include "frame_profiler.hpp"
+#include "gpu_timer.hpp"
+#include "level_history.hpp"
+#include "lod_controller.hpp"
+#include "options.hpp"
+#include "program_binary_cache.hpp"
+#include "room_vertices.hpp"
+#include "room_views.hpp"
+#include "shader_cache.hpp"
+#include "shader_m.h"
+#include "shader_source.hpp"
+#include "speaker_points/displacement_engine.hpp"
+#include "speaker_points/speaker_dbs.hpp"
+#include "speaker_points/speaker_layout.hpp"
+#include "speaker_points/speaker_points.hpp"
+#include "texture_buffer.hpp"
+#include "texture_loader.hpp"
+#include "uniform_buffer.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The visualiser scene: the displaced Fibonacci sphere, its shader and the
+// per-frame uniform block. Owns GL objects only, so it draws into whatever
+// framebuffer is bound; the window and the headless renderer share it.
+//
+// By default room.vs displaces the sphere on the GPU, reading each vertex's
+// angle to every speaker from a texture buffer baked by setLayout() and
+// sinc from a sampled table, so the per-frame work has no acos or sin. With
+// cpuDisplacement a DisplacementEngine computes the model on the CPU each
+// frame and streams the displaced points into the vertex buffer, which
+// room_cpu.vs only transforms.
+//
+// The speaker count comes from the SpeakerLayout: the levels go through a
+// LevelHistory sized to the layout, and room.vs is compiled once per speaker
+// count with NUM_SPKRS fixed, so a stereo track doesn't run a 24-speaker loop.
+//
+// Levels are not set per epoch. The caller feeds upcoming epochs in batches
+// (needsEpochs(), addEpoch()) and every frame interpolates between them at
+// its own time, in room.vs or, with cpuDisplacement, on the CPU.
+//
+// The sphere is a chain of Fibonacci spheres of increasing density in one
+// vertex buffer, and each frame draws one level's range. With a frame budget
+// a LodController picks the level from the measured frame cost (the caller's
+// CPU time for the whole frame, passed to endFrame(), or the GPU time of
+// draw() if that is longer); otherwise the chain is just the --points sphere.
+//
+// With setProfiler() the upload and draw are timed as FrameProfiler scopes
+// and the same GPU queries report the frame's GPU time.
+//
+// The walls (krear_room) are textured with --room-texture, which a
+// TextureLoader decodes off the render thread and streams in a little per
+// frame; they are drawn from the first frame their texture is resident.
+//
+// --views picks one or more cameras (RoomViews), tiled over the framebuffer.
+// Each draw is instanced once per view, so all views go out in the same
+// calls. The displacement is only computed once: on the CPU path the views
+// share the streamed points, and on the GPU path room.vs runs once with
+// transform feedback into a buffer that room_cpu.vs then draws per view.
 class Room {
-    // TODO: Move all room-related data and logic to this header.
+public:
+  static constexpr int kDefaultNumPoints = 2048;
+  static constexpr GLuint kFrameParamsBinding = 0;
+  static constexpr GLuint kViewsBinding = 2;
+  static constexpr GLuint kSpkrAnglesUnit = 0;
+  static constexpr GLuint kSincLutUnit = 1;
+  static constexpr GLuint kWallTextureUnit = 2;
+  static constexpr GLuint kLevelHistoryUnit = 3;
+  // The walls sit around the sphere rather than touching it.
+  static constexpr float kRoomScale = 2.f;
+  // sinc arguments the table covers. Beyond it sinc stays below
+  // 1 / (pi * range) and the shader reads the last sample.
+  static constexpr float kSincLutRange = 2048.f;
+  static constexpr float kEpochTime = 0.03f; // Perfect.
+  // Low / mid / high crossovers for the per-band amplitudes.
+  inline static const std::vector<float> kBandSplits_hz = {250.f, 4000.f};
+
+  // The analysis --loudness asks for: RMS with band levels, or momentary
+  // loudness alone (the bands would override it in room.vs).
+  static LoudnessGenerator makeLoudnessGenerator(const RunOptions &options) {
+    if (options.loudness == "lufs") {
+      return LoudnessGenerator(options.audioPath, kEpochTime, {},
+                               LoudnessMode::kLufs);
+    }
+    if (options.loudness != "rms") {
+      std::cout << "ERROR::OPTIONS::UNKNOWN_LOUDNESS: " << options.loudness
+                << ", using rms" << std::endl;
+    }
+    return LoudnessGenerator(options.audioPath, kEpochTime, kBandSplits_hz);
+  }
+
+  // Takes the point count, displacement path, sinc table resolution, shader
+  // sources, program cache and framebuffer size from the options; `layout`
+  // should have one speaker per channel of the track.
+  Room(const RunOptions &options, const SpeakerLayout &layout)
+      : programCache(programCacheDir(options)),
+        shaders(loadShaderSource(options.shaderDir, options.cpuDisplacement
+                                                        ? "room_cpu.vs"
+                                                        : "room.vs"),
+                loadShaderSource(options.shaderDir, "room.fs"), &programCache,
+                options.cpuDisplacement
+                    ? std::vector<std::string>{}
+                    : std::vector<std::string>{"v_displaced"}),
+        capturedShaders(loadShaderSource(options.shaderDir, "room_cpu.vs"),
+                        loadShaderSource(options.shaderDir, "room.fs"),
+                        &programCache),
+        wallShaders(loadShaderSource(options.shaderDir, "walls.vs"),
+                    loadShaderSource(options.shaderDir, "walls.fs"),
+                    &programCache),
+        textures(roomTextures(options)), frameUniforms(kFrameParamsBinding),
+        interpolation(levelInterpolation(options)), spkrAngles(GL_R32F),
+        sincLut(GL_R32F),
+        kAspect(static_cast<float>(options.width) / options.height),
+        views(options.views, kAspect), viewUniforms(kViewsBinding) {
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    const bool useLods = options.frameBudget_ms > 0.f;
+    lods = useLods ? generateFibonacciSphereLods(options.lodMinPoints,
+                                                 options.lodMaxPoints)
+                   : generateFibonacciSphereLods(options.numPoints,
+                                                 options.numPoints);
+    if (!options.cpuDisplacement) {
+      // Every level's angles share one texture buffer.
+      lods.truncate(TextureBuffer::maxTexels() /
+                    std::max<size_t>(layout.size(), 1));
+    }
+    // Start from the densest level no larger than --points.
+    while (lodLevel + 1 < lods.getNumLevels() &&
+           lods.counts[lodLevel + 1] <= static_cast<size_t>(options.numPoints)) {
+      ++lodLevel;
+    }
+    if (useLods) {
+      lodController = std::make_unique<LodController>(
+          lods.counts, lodLevel, options.frameBudget_ms);
+      std::cout << "LOD: " << lods.getNumLevels() << " levels, "
+                << lods.counts.front() << " to " << lods.counts.back()
+                << " points, " << options.frameBudget_ms << " ms budget\n";
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &sphereVertBuffer);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVertBuffer);
+    if (options.cpuDisplacement) {
+      // Four float streams (x, y, z, displacement), rewritten every frame.
+      displacementEngine = std::make_unique<DisplacementEngine>(
+          lods.points, layout.getPositions());
+      const size_t streamBytes = lods.points.size() * sizeof(float);
+      glBufferData(GL_ARRAY_BUFFER, 4 * streamBytes, nullptr, GL_STREAM_DRAW);
+      for (GLuint i = 0; i < 4; ++i) {
+        glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+                              (void *)(i * streamBytes));
+        glEnableVertexAttribArray(i);
+      }
+      std::cout << "CPU displacement: " << displaceKernel().name << " x "
+                << displacementEngine->getNumThreads() << " threads\n";
+    } else {
+      glBufferData(GL_ARRAY_BUFFER, lods.points.size() * sizeof(glm::vec3),
+                   lods.points.data(), GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                            (void *)0);
+      glEnableVertexAttribArray(0);
+    }
+
+    if (!options.cpuDisplacement && views.size() > 1) {
+      // room.vs writes v_displaced here once per frame; read back as the
+      // same four streams room_cpu.vs takes, interleaved.
+      glGenVertexArrays(1, &captureVAO);
+      glGenBuffers(1, &captureBuffer);
+      glBindVertexArray(captureVAO);
+      glBindBuffer(GL_ARRAY_BUFFER, captureBuffer);
+      glBufferData(GL_ARRAY_BUFFER, lods.counts.back() * sizeof(glm::vec4),
+                   nullptr, GL_DYNAMIC_COPY);
+      for (GLuint i = 0; i < 4; ++i) {
+        glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                              (void *)(i * sizeof(float)));
+        glEnableVertexAttribArray(i);
+      }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    views.fill(viewUniforms.edit());
+    if (views.size() > 1) {
+      for (GLenum plane = 0; plane < 4; ++plane) {
+        glEnable(GL_CLIP_DISTANCE0 + plane);
+      }
+      std::cout << "Views:";
+      for (size_t i = 0; i < views.size(); ++i) {
+        std::cout << " " << views[i].name;
+      }
+      std::cout << "\n";
+    }
+
+    if (textures.size() > 0) {
+      glGenVertexArrays(1, &wallVAO);
+      glGenBuffers(1, &wallVertBuffer);
+      glBindVertexArray(wallVAO);
+      glBindBuffer(GL_ARRAY_BUFFER, wallVertBuffer);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(krear_room), krear_room,
+                   GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                            (void *)0);
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                            (void *)(3 * sizeof(float)));
+      glEnableVertexAttribArray(1);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glBindVertexArray(0);
+      wallShader = &wallShaders.get("", [this](Shader &s) {
+        s.setMat4("u_model",
+                  glm::scale(glm::mat4(1.f), glm::vec3(kRoomScale)));
+        s.setInt("u_wallTexture", kWallTextureUnit);
+        s.bindUniformBlock("Views", kViewsBinding);
+      });
+    }
+
+    // Set constants like rendering params; the model and sampler uniforms are
+    // set per shader permutation in selectShader().
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    if (!displacementEngine) {
+      // Keep the table within this context's texture buffer limit.
+      sincLutResolution = options.sincLutResolution;
+      const float range = std::min(
+          kSincLutRange, (TextureBuffer::maxTexels() - 1) / sincLutResolution);
+      const std::vector<float> table = sincTable(range, sincLutResolution);
+      sincLut.upload(table.data(), table.size() * sizeof(float));
+    }
+    setLayout(layout);
+    FrameUniforms &frame = frameUniforms.edit();
+    // Vertex wave uniforms
+    frame.baseSpatialFrequency = 5.f;
+    frame.amplitudeFrequencyScale = 10.f;
+    frame.maxOverallDisplacement = .2f;
+    frame.spatialDecayRate = 2.f;
+    // Fragment uniforms
+    frame.lightDir = glm::vec4(-1.f, 0.f, -1.f, 0.f);
+    frame.lightColor = glm::vec4(1.f, 1.f, 1.f, 0.f);
+    frame.ambientColor = glm::vec4(0.f, 1.f, 1.f, 0.f);
+    frame.baseColor = glm::vec4(0.153, 0.0936, 0.390, 0.f);
+    frame.wavePeakColor = glm::vec4(0.850, 0, 0, 0.f);
+    frame.waveColorScale = 5.f;
+    frame.waveColorOffset = 0.f;
+  }
+
+  // Must run while the GL context is still current.
+  void destroy() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &sphereVertBuffer);
+    glDeleteVertexArrays(1, &wallVAO);
+    glDeleteBuffers(1, &wallVertBuffer);
+    glDeleteVertexArrays(1, &captureVAO);
+    glDeleteBuffers(1, &captureBuffer);
+    shaders.destroy();
+    capturedShaders.destroy();
+    wallShaders.destroy();
+    textures.destroy();
+    frameUniforms.destroy();
+    history.destroy();
+    viewUniforms.destroy();
+    gpuTimer.destroy();
+    spkrAngles.destroy();
+    sincLut.destroy();
+  }
+
+  Room(const Room &) = delete;
+  Room &operator=(const Room &) = delete;
+
+  // Speaker layout changed: resize the level history (dropping every epoch),
+  // switch to the room.vs permutation for the new speaker count and rebake
+  // every vertex's angle to each speaker.
+  void setLayout(const SpeakerLayout &layout) {
+    std::vector<glm::vec3> spkrPos = layout.getPositions();
+    const size_t maxSpeakers = TextureBuffer::maxTexels() / history.getDepth();
+    if (spkrPos.size() > maxSpeakers) {
+      std::cout << "ERROR::LAYOUT::TOO_MANY_SPEAKERS: " << layout.name
+                << " has " << spkrPos.size() << ", drawing the first "
+                << maxSpeakers << std::endl;
+      spkrPos.resize(maxSpeakers);
+    }
+    numSpkrs = spkrPos.size();
+    history.reset(numSpkrs);
+    selectShader();
+    std::cout << "Speaker layout: " << layout.name << " (" << spkrPos.size()
+              << " speakers)\n";
+    if (displacementEngine) {
+      displacementEngine->setSpeakers(spkrPos);
+      return;
+    }
+    const std::vector<float> angles =
+        speakerAngles(lods.points, spkrPos, spkrPos.size());
+    spkrAngles.upload(angles.data(), angles.size() * sizeof(float));
+  }
+
+  void setTime(float time) { frameUniforms.edit().time = time; }
+  void setUseBands(bool useBands) { frameUniforms.edit().useBands = useBands; }
+  // Spacing of the epochs' timestamps; drops every epoch fed so far.
+  void setEpochPeriod(float period_s) {
+    history.setPeriod(period_s);
+    frameUniforms.edit().epochPeriod = period_s;
+  }
+
+  // Fewer than half the history's epochs lie ahead of the current time: feed
+  // every epoch starting before getEpochHorizon_s() through addEpoch().
+  bool needsEpochs() const { return history.needsRefill(getTime()); }
+  float getEpochHorizon_s() const { return history.getHorizon_s(getTime()); }
+  float getEpochWindowStart_s() const {
+    return history.getWindowStart_s(getTime());
+  }
+  // Channels past the last speaker are ignored. Uploaded with the next
+  // draw(), together with the rest of the batch.
+  bool addEpoch(const LoudnessEpoch &epoch, int numBands) {
+    return history.add(epoch, numBands, getTime());
+  }
+  // Start time of the newest epoch shown at the current time, or -1.
+  float getShownEpochTime() const {
+    return history.getEpochTimeAt(getTime());
+  }
+
+  size_t getNumPoints() const { return lods.counts[lodLevel]; }
+
+  // Blocks until the room textures are fully uploaded, so every frame from
+  // here on looks the same however fast the loader is.
+  void finishLoading() { textures.finish(); }
+
+  // Clears the bound framebuffer and draws one frame.
+  void draw() {
+    if (timeGpu()) {
+      pollGpuTimer();
+    }
+    const size_t first = lods.offsets[lodLevel];
+    const size_t count = lods.counts[lodLevel];
+
+    {
+      FrameProfiler::Scope scope(*profiler, FrameProfiler::Upload);
+      upload(first, count);
+      if (!textures.isDone()) {
+        textures.update();
+      }
+    }
+
+    FrameProfiler::Scope scope(*profiler, FrameProfiler::Draw);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    const bool timed = timeGpu() && gpuTimer.begin();
+    if (timed) {
+      profiler->gpuQueryIssued();
+    }
+    const GLsizei numViews = static_cast<GLsizei>(views.size());
+
+    // Behind the sphere, which is drawn over them without a depth test.
+    if (wallShader != nullptr && textures.isReady(0)) {
+      wallShader->use();
+      glActiveTexture(GL_TEXTURE0 + kWallTextureUnit);
+      glBindTexture(GL_TEXTURE_2D, textures.getTexture(0));
+      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      glBindVertexArray(wallVAO);
+      glDrawArraysInstanced(GL_TRIANGLES, 0,
+                            sizeof(krear_room) / (5 * sizeof(float)), numViews);
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+
+    shader->use();
+    if (!displacementEngine) {
+      spkrAngles.bind(kSpkrAnglesUnit);
+      history.bind(kLevelHistoryUnit);
+      sincLut.bind(kSincLutUnit);
+    }
+    glBindVertexArray(VAO);
+    glPointSize(7.f);
+    if (captureVAO != 0) {
+      // One displacement pass, then every view draws the captured points.
+      glEnable(GL_RASTERIZER_DISCARD);
+      glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, captureBuffer);
+      glBeginTransformFeedback(GL_POINTS);
+      glDrawArrays(GL_POINTS, first, count);
+      glEndTransformFeedback();
+      glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+      glDisable(GL_RASTERIZER_DISCARD);
+      capturedShader->use();
+      glBindVertexArray(captureVAO);
+      glDrawArraysInstanced(GL_POINTS, 0, count, numViews);
+    } else {
+      glDrawArraysInstanced(GL_POINTS, first, count, numViews);
+    }
+    if (timed) {
+      gpuTimer.end();
+    }
+  }
+
+  // Feeds the LOD controller the frame's cost: the CPU time the caller
+  // measured for the whole frame or the latest GPU time of draw(), whichever
+  // is longer. Moves to the level it picks from the next draw() on. The first
+  // frame also links shaders and fills the level history, so it is skipped.
+  void endFrame(std::chrono::duration<double, std::milli> cpuFrame) {
+    if (!firstFrameEnded) {
+      firstFrameEnded = true;
+      return;
+    }
+    if (lodController &&
+        lodController->update(std::max(cpuFrame.count(), gpuFrame_ms))) {
+      lodLevel = lodController->getLevel();
+      std::cout << "LOD: " << lods.counts[lodLevel] << " points ("
+                << lodController->getSmoothedCost_ms() << " ms/frame)\n";
+    }
+  }
+
+  // Records CPU scopes and GPU frame times into `p`, which must outlive the
+  // room (or be replaced before it goes).
+  void setProfiler(FrameProfiler &p) { profiler = &p; }
+
+private:
+  static std::string programCacheDir(const RunOptions &options) {
+    if (!options.programCache) {
+      return "";
+    }
+    return options.programCacheDir.empty() ? ProgramBinaryCache::defaultDir()
+                                           : options.programCacheDir;
+  }
+
+  static std::vector<std::string> roomTextures(const RunOptions &options) {
+    if (options.roomTexturePath.empty()) {
+      return {};
+    }
+    return {options.roomTexturePath};
+  }
+
+  static LevelHistory::Interpolation
+  levelInterpolation(const RunOptions &options) {
+    LevelHistory::Interpolation interpolation = LevelHistory::Linear;
+    if (!LevelHistory::parseInterpolation(options.levelInterpolation,
+                                          interpolation)) {
+      std::cout << "ERROR::OPTIONS::UNKNOWN_INTERPOLATION: "
+                << options.levelInterpolation << ", using linear"
+                << std::endl;
+    }
+    return interpolation;
+  }
+
+  float getTime() const { return frameUniforms.get().time; }
+
+  bool timeGpu() const { return lodController || profiler->isEnabled(); }
+
+  // Pushes this frame's uniforms and, with CPU displacement, the displaced
+  // points of [first, first + count).
+  void upload(size_t first, size_t count) {
+    history.flush();
+    FrameUniforms &frame = frameUniforms.edit();
+    frame.historyFirst = static_cast<int>(history.getFirst());
+    frame.historyLast = static_cast<int>(history.getLast());
+    // At most one buffer update per frame.
+    frameUniforms.flush();
+    viewUniforms.flush();
+    if (!displacementEngine) {
+      return;
+    }
+    history.sample(getTime(), interpolation, spkrLevels);
+    // Orphan last frame's storage so the driver never waits on a draw still
+    // reading it.
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVertBuffer);
+    void *points = glMapBufferRange(
+        GL_ARRAY_BUFFER, 0, 4 * lods.points.size() * sizeof(float),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (points != nullptr) {
+      displacementEngine->displace(frameUniforms.get(), spkrLevels,
+                                   static_cast<float *>(points), first,
+                                   first + count);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // Hands finished GPU frame timings to the profiler and keeps the latest
+  // for the LOD controller.
+  void pollGpuTimer() {
+    gpuTimer.poll([this](double gpu_ms) {
+      profiler->addGpuTime(gpu_ms);
+      gpuFrame_ms = gpu_ms;
+    });
+  }
+
+  // Makes the permutation for the current speaker count current, compiling
+  // it on first use. room_cpu.vs has no speaker loop, so it has just one.
+  void selectShader() {
+    const std::string defines =
+        displacementEngine
+            ? ""
+            : "#define NUM_SPKRS " + std::to_string(numSpkrs) + "\n" +
+                  "#define LEVEL_INTERP " + std::to_string(interpolation) +
+                  "\n";
+    shader = &shaders.get(defines, [this](Shader &s) {
+      initPointShader(s);
+      if (!displacementEngine) {
+        s.setInt("u_spkrAngles", kSpkrAnglesUnit);
+        s.setInt("u_sincLut", kSincLutUnit);
+        s.setFloat("u_sincLutResolution", sincLutResolution);
+        s.setInt("u_levelHistory", kLevelHistoryUnit);
+      }
+    });
+    if (captureVAO != 0) {
+      capturedShader = &capturedShaders.get("", [this](Shader &s) {
+        initPointShader(s);
+      });
+    }
+  }
+
+  // The model matrix is constant and the cameras come from the Views block,
+  // so this runs once per permutation.
+  void initPointShader(const Shader &program) {
+    program.setMat4("u_model", glm::mat4(1.0f));
+    // Per-frame uniforms live in one std140 block shared by both stages.
+    program.bindUniformBlock("FrameParams", kFrameParamsBinding);
+    program.bindUniformBlock("Views", kViewsBinding);
+  }
+
+  ProgramBinaryCache programCache;
+  ShaderPermutations shaders;
+  Shader *shader = nullptr;
+  ShaderPermutations capturedShaders;
+  Shader *capturedShader = nullptr;
+  ShaderPermutations wallShaders;
+  Shader *wallShader = nullptr;
+  TextureLoader textures;
+  UniformBuffer<FrameUniforms> frameUniforms;
+  LevelHistory history;
+  LevelHistory::Interpolation interpolation;
+  size_t numSpkrs = 0;
+  // CPU displacement only: this frame's interpolated levels.
+  std::vector<glm::vec4> spkrLevels;
+  TextureBuffer spkrAngles;
+  TextureBuffer sincLut;
+  const float kAspect;
+  RoomViews views;
+  UniformBuffer<ViewUniforms> viewUniforms;
+  float sincLutResolution = 0.f;
+  FibonacciSphereLods lods;
+  size_t lodLevel = 0;
+  std::unique_ptr<LodController> lodController;
+  GpuTimer gpuTimer;
+  FrameProfiler noProfiler{""};
+  FrameProfiler *profiler = &noProfiler;
+  double gpuFrame_ms = 0.0;
+  bool firstFrameEnded = false;
+  std::unique_ptr<DisplacementEngine> displacementEngine;
+  GLuint VAO = 0;
+  GLuint sphereVertBuffer = 0;
+  GLuint wallVAO = 0;
+  GLuint wallVertBuffer = 0;
+  GLuint captureVAO = 0;
+  GLuint captureBuffer = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
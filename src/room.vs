@@ -1,36 +1,121 @@
 #version 330 core
-#define NUM_SPKRS 3 // Define the maximum number of speakers/sources
+// NUM_SPKRS, the number of speakers/sources in the layout, is defined per
+// layout by Room through ShaderPermutations, so the speaker loop has a
+// compile-time trip count. LEVEL_INTERP picks how levels are interpolated
+// between epochs: 0 step, 1 linear, 2 Catmull-Rom.
+#ifndef NUM_SPKRS
+#error NUM_SPKRS must be defined by the application
+#endif
+#ifndef LEVEL_INTERP
+#define LEVEL_INTERP 1
+#endif
 layout(location = 0) in vec3 a_position; // Base position of the point on a sphere (ideally unit sphere)
 
-// Transformation matrices (Must be uniforms)
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
-
-// Speaker/Source data (Current Loudness/Amplitude - Uniform)
-uniform float u_spkrAmplitude[NUM_SPKRS]; // Current linear amplitude for each speaker/source
-uniform vec3 u_spkrPos[NUM_SPKRS];        // Position of each speaker/source (Typically uniforms)
+// The camera of each instance (ViewUniforms in uniform_buffer.hpp): a
+// multi-view draw has one instance per view.
+#define MAX_VIEWS 4
+layout(std140) uniform Views {
+    mat4 u_viewProjection[MAX_VIEWS];
+    vec4 u_viewTile[MAX_VIEWS]; // xy: NDC scale, zw: NDC offset of the view's tile
+};
+
+// Moves a clip-space position of this instance's view into its tile, clipping
+// against the tile's edges so nothing spills into a neighbour.
+vec4 toTile(vec4 clip) {
+    vec4 tile = u_viewTile[gl_InstanceID];
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+    return vec4(clip.xy * tile.xy + tile.zw * clip.w, clip.zw);
+}
 
-// --- Sinc Wave Simulation Parameters (Constants) ---
-// These values are hardcoded. Change them requires recompiling the shader.
-const float C_BASE_SPATIAL_FREQUENCY = 5.0;       // Base frequency of the sinc wave (controls ripple density)
-const float C_AMPLITUDE_SPATIAL_FREQUENCY_SCALE = 10.0; // How much amplitude scales the sinc wave frequency
-const float C_MAX_OVERALL_DISPLACEMENT = 0.2;     // Maximum possible displacement scale from all sources combined
-const float C_SPATIAL_DECAY_RATE = 2.0;           // Controls overall decay with geodesic distance from source
+// Geodesic distance (angle in radians) from each vertex to each speaker/source,
+// NUM_SPKRS per vertex. Baked by Room::setLayout whenever the layout changes.
+uniform samplerBuffer u_spkrAngles;
+// sinc(x) sampled u_sincLutResolution times per unit x, starting at x = 0
+// (sincTable in displacement_engine.hpp)
+uniform samplerBuffer u_sincLut;
+uniform float u_sincLutResolution;
+
+// Per-frame parameters, shared with the fragment shader and updated with one
+// buffer upload per frame (FrameUniforms in uniform_buffer.hpp).
+layout(std140) uniform FrameParams {
+    vec4 u_lightDir;                  // xyz: direction *to* the light source
+    vec4 u_lightColor;                // xyz: color/intensity of the light
+    vec4 u_ambientColor;              // xyz: ambient light color
+    vec4 u_baseColor;                 // xyz: color for areas with low or no displacement
+    vec4 u_wavePeakColor;             // xyz: color for areas with high displacement
+    float u_time;
+    float u_waveColorScale;           // Scales v_displacementMagnitude into [0, 1] for color interpolation
+    float u_waveColorOffset;          // Optional offset for the displacement mapping
+    float u_baseSpatialFrequency;     // Base frequency of the sinc wave (controls ripple density)
+    float u_amplitudeFrequencyScale;  // How much amplitude scales the sinc wave frequency
+    float u_maxOverallDisplacement;   // Maximum possible displacement scale from all sources combined
+    float u_spatialDecayRate;         // Controls overall decay with geodesic distance from source
+    int u_useBands;                   // Drive the waves from the bands instead of the broadband amplitude
+    float u_epochPeriod;              // Seconds between epoch timestamps
+    int u_historyFirst;               // Oldest epoch in u_levelHistory
+    int u_historyLast;                // Newest epoch in u_levelHistory (< u_historyFirst: none yet)
+};
+
+// Per-speaker levels of the resident epochs (LevelHistory in
+// level_history.hpp): epoch k's NUM_SPKRS texels start at
+// (k % depth) * NUM_SPKRS. x: broadband amplitude, yzw: low/mid/high band
+// amplitude.
+uniform samplerBuffer u_levelHistory;
 
 // Outputs to the fragment shader
 out float v_displacementMagnitude; // Absolute magnitude of the total displacement
 out vec3 v_normal;                 // Displaced normal for lighting
+// Displaced position (xyz) and signed displacement (w), captured with
+// transform feedback when Room shares one displacement pass between views.
+out vec4 v_displaced;
 
-// Helper function for the normalized sinc function
+// Helper function for the normalized sinc function: a linear interpolation of
+// the lookup table. sinc is even, and arguments past the end of the table
+// read its last sample.
 float sinc(float x) {
-    // Use a small epsilon to handle the singularity at x=0
-    const float PI = 3.14159265359;
-    if(abs(x) < 1e-5) {
-        return 1.0;
-    } else {
-        return sin(PI * x) / (PI * x);
+    float last = float(textureSize(u_sincLut) - 1);
+    float pos = min(abs(x) * u_sincLutResolution, last);
+    int i = int(min(floor(pos), last - 1.0));
+    return mix(texelFetch(u_sincLut, i).r, texelFetch(u_sincLut, i + 1).r, pos - float(i));
+}
+
+vec4 epochLevel(int k, int spkr) {
+    // Epochs outside the window read as the nearest resident one.
+    k = clamp(k, u_historyFirst, u_historyLast);
+    int depth = textureSize(u_levelHistory) / NUM_SPKRS;
+    return texelFetch(u_levelHistory, (k % depth) * NUM_SPKRS + spkr);
+}
+
+// A speaker's levels at u_time, as LevelHistory::sample computes them. Each
+// epoch is keyed at the middle of its window.
+vec4 spkrLevel(int spkr) {
+    if (u_historyLast < u_historyFirst) {
+        return vec4(0.0);
     }
+#if LEVEL_INTERP == 0
+    return epochLevel(int(floor(u_time / u_epochPeriod)), spkr);
+#else
+    float pos = u_time / u_epochPeriod - 0.5;
+    int k = int(floor(pos));
+    float t = pos - float(k);
+#if LEVEL_INTERP == 1
+    return mix(epochLevel(k, spkr), epochLevel(k + 1, spkr), t);
+#else
+    vec4 p0 = epochLevel(k - 1, spkr);
+    vec4 p1 = epochLevel(k, spkr);
+    vec4 p2 = epochLevel(k + 1, spkr);
+    vec4 p3 = epochLevel(k + 2, spkr);
+    vec4 level = 0.5 * (2.0 * p1 + (p2 - p0) * t +
+                        (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * t * t +
+                        (3.0 * (p1 - p2) + p3 - p0) * t * t * t);
+    // Catmull-Rom overshoots; keep it within the keys it blends.
+    return clamp(level, min(min(p0, p1), min(p2, p3)), max(max(p0, p1), max(p2, p3)));
+#endif
+#endif
 }
 
 void main() {
@@ -41,17 +126,23 @@ void main() {
     float signedDisplacementMagnitude = 0.0;
 
     for(int i = 0; i < NUM_SPKRS; ++i) {
-        vec3 waveOrigin = u_spkrPos[i];
-
-        // --- Calculate Geodesic Distance (Angle) from Point to Wave Origin on the Unit Sphere ---
-        float dot_product = dot(normalize(basePosition), normalize(waveOrigin));
-        dot_product = clamp(dot_product, -1.0, 1.0);
-        float angleFromSource = acos(dot_product); // Geodesic distance (angle in radians)
+        // In band mode the low and mid bands set how far the surface moves and
+        // the high band sets how tightly it ripples.
+        vec4 level = spkrLevel(i);
+        float amplitude = level.x;
+        float rippleDrive = amplitude;
+        if(u_useBands != 0) {
+            amplitude = level.y + 0.5 * level.z;
+            rippleDrive = level.w;
+        }
+
+        // --- Geodesic Distance (Angle) from Point to Wave Origin on the Unit Sphere ---
+        float angleFromSource = texelFetch(u_spkrAngles, gl_VertexID * NUM_SPKRS + i).r;
 
         // --- Calculate Sinc Function Input ---
         // The frequency scales with amplitude: freq = baseFreq + amplitudeScale * amplitude
-        // Use the current amplitude directly as there's no interpolation
-        float currentSpatialFrequency = C_BASE_SPATIAL_FREQUENCY + C_AMPLITUDE_SPATIAL_FREQUENCY_SCALE * u_spkrAmplitude[i];
+        // (already interpolated between epochs by spkrLevel(), see LEVEL_INTERP)
+        float currentSpatialFrequency = u_baseSpatialFrequency + u_amplitudeFrequencyScale * rippleDrive;
         float sinc_input = currentSpatialFrequency * angleFromSource;
 
         // --- Calculate Sinc Wave Contribution ---
@@ -59,16 +150,16 @@ void main() {
         float sincWaveValue = 3 * sinc(sinc_input);
 
         // Apply a spatial decay based on distance from source
-        // float spatialDecay = exp(-C_SPATIAL_DECAY_RATE * angleFromSource);
+        // float spatialDecay = exp(-u_spatialDecayRate * angleFromSource);
         float spatialDecay = 1;
 
         // Combine factors for this source's contribution
         // No temporal oscillation in this version. The pattern is static in space per amplitude value.
-        signedDisplacementMagnitude += u_spkrAmplitude[i] * sincWaveValue * spatialDecay;
+        signedDisplacementMagnitude += amplitude * sincWaveValue * spatialDecay;
     }
 
     // Scale the total accumulated displacement by the maximum allowed
-    signedDisplacementMagnitude *= C_MAX_OVERALL_DISPLACEMENT;
+    signedDisplacementMagnitude *= u_maxOverallDisplacement;
 
     // Calculate the final displaced position
     vec3 displacementDirection = normalize(basePosition);
@@ -80,6 +171,8 @@ void main() {
     // Pass the absolute total displacement magnitude to the fragment shader
     v_displacementMagnitude = abs(signedDisplacementMagnitude);
 
+    v_displaced = vec4(displacedPosition, signedDisplacementMagnitude);
+
     // Apply Model, View, and Projection matrices
-    gl_Position = u_projection * u_view * u_model * vec4(displacedPosition, 1.0);
+    gl_Position = toTile(u_viewProjection[gl_InstanceID] * u_model * vec4(displacedPosition, 1.0));
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 330 core
+// Pass-through variant of room.vs for Room's CPU displacement path: the
+// points arrive already displaced (DisplacementEngine in displacement_engine.hpp),
+// one float stream per component. Also draws the points room.vs captured
+// when several views share one displacement pass.
+layout(location = 0) in float a_x;
+layout(location = 1) in float a_y;
+layout(location = 2) in float a_z;
+layout(location = 3) in float a_displacement; // Signed total displacement
+
+uniform mat4 u_model;
+// The camera of each instance (ViewUniforms in uniform_buffer.hpp): a
+// multi-view draw has one instance per view.
+#define MAX_VIEWS 4
+layout(std140) uniform Views {
+    mat4 u_viewProjection[MAX_VIEWS];
+    vec4 u_viewTile[MAX_VIEWS]; // xy: NDC scale, zw: NDC offset of the view's tile
+};
+
+// Moves a clip-space position of this instance's view into its tile, clipping
+// against the tile's edges so nothing spills into a neighbour.
+vec4 toTile(vec4 clip) {
+    vec4 tile = u_viewTile[gl_InstanceID];
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+    return vec4(clip.xy * tile.xy + tile.zw * clip.w, clip.zw);
+}
+
+// Outputs to the fragment shader
+out float v_displacementMagnitude; // Absolute magnitude of the total displacement
+out vec3 v_normal;                 // Displaced normal for lighting
+
+void main() {
+    vec3 displacedPosition = vec3(a_x, a_y, a_z);
+
+    // Same outputs room.vs derives from its displaced position
+    v_normal = normalize(displacedPosition);
+    v_displacementMagnitude = abs(a_displacement);
+
+    gl_Position = toTile(u_viewProjection[gl_InstanceID] * u_model * vec4(displacedPosition, 1.0));
+}
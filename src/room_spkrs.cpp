@@ -10,9 +10,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include "room_vertices.hpp"
-#include "speaker_vertices.hpp"
+#include "options.hpp"
 #include "shader_m.h"
+#include "shader_source.hpp"
+#include "speaker_markers.hpp"
+#include "speaker_points/speaker_layout.hpp"
 
 #include <iostream>
 
@@ -23,7 +25,7 @@ void processInput(GLFWwindow *window);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-int main()
+int main(int argc, char **argv)
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -57,62 +59,24 @@ int main()
     }
 
     // Build shader program.
-    Shader ourShader("/Users/joelm/Downloads/joelgl 2/src/spkr.vs", "/Users/joelm/Downloads/joelgl 2/src/spkr.fs");
-
-    // Define vertices and indices
-std::vector<glm::vec3> spkr_verts = {
-    glm::vec3(-0.5f, 0.0f, -1.0f),
-    glm::vec3(0.5f, 0.0f, -1.0f),
-    glm::vec3(0.0f, 0.8f, -1.0f),
-};
-
-const float norm_offset = 0.06f;
-auto front_speaker_coords = kfront_spkrs;
-auto front_speaker_norm = glm::vec3(norm_offset, 0.f, 0.f);
-auto front_speaker_verts = spkr_from_coord(front_speaker_coords.data(), front_speaker_coords.size(), front_speaker_norm);
-
-auto side_speaker_coords = kside_spkrs;
-auto side_speaker_norm = glm::vec3(0.f, 0.f, norm_offset);
-auto side_speaker_verts = spkr_from_coord(side_speaker_coords.data(), side_speaker_coords.size(), side_speaker_norm);
-
-auto rear_speaker_coords = krear_spkrs;
-auto rear_speaker_norm = glm::vec3(norm_offset, 0.f, 0.f);
-auto rear_speaker_verts = spkr_from_coord(rear_speaker_coords.data(), rear_speaker_coords.size(), rear_speaker_norm);
-
-// Combine all speaker vertices into one vector
-std::vector<glm::vec3> all_speaker_verts;
-all_speaker_verts.reserve(front_speaker_verts.size() + side_speaker_verts.size() + rear_speaker_verts.size());
-all_speaker_verts.insert(all_speaker_verts.end(), front_speaker_verts.begin(), front_speaker_verts.end());
-all_speaker_verts.insert(all_speaker_verts.end(), side_speaker_verts.begin(), side_speaker_verts.end());
-all_speaker_verts.insert(all_speaker_verts.end(), rear_speaker_verts.begin(), rear_speaker_verts.end());
-
-std::array<unsigned int, 6> spkr_vert_idx = 
-{   0, 1, 2, 
-    1, 2, 3,
-};
-std::vector<unsigned int> all_spkr_vert_idx;
-// Fill the vector with multiple copies of spkr_vert_idx
-for (int i = 0; i < (kfront_spkrs.size() + kside_spkrs.size() + krear_spkrs.size()); ++i) {
-    for (int j = 0; j < spkr_vert_idx.size(); ++j) {
-        all_spkr_vert_idx.push_back(spkr_vert_idx[j] + i * 4);
+    const RunOptions options = parseOptions(argc, argv);
+    Shader ourShader(loadShaderSource(options.shaderDir, "spkr.vs"), loadShaderSource(options.shaderDir, "spkr.fs"));
+
+    // Speaker positions come from a layout preset or file (--layout), 7.1.4 by default.
+    SpeakerLayout layout = *SpeakerLayout::findPreset("7.1.4");
+    if (!options.layout.empty()) {
+        if (const SpeakerLayout *preset = SpeakerLayout::findPreset(options.layout)) {
+            layout = *preset;
+        } else {
+            SpeakerLayout::load(options.layout, layout);
+        }
     }
-}
-
-// Generate and bind VAO, VBO, and EBO
-unsigned int VAO, VBO, EBO;
-glGenVertexArrays(1, &VAO);
-glGenBuffers(1, &VBO);
-glGenBuffers(1, &EBO);
-
-glBindVertexArray(VAO);
+    std::cout << "Speaker layout: " << layout.name << " (" << layout.size() << " speakers)" << std::endl;
 
-glBindBuffer(GL_ARRAY_BUFFER, VBO);
-glBufferData(GL_ARRAY_BUFFER, all_speaker_verts.size() * sizeof(glm::vec3), all_speaker_verts.data(), GL_STATIC_DRAW);
-glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-glEnableVertexAttribArray(0);
-
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(spkr_vert_idx) * all_spkr_vert_idx.size(), all_spkr_vert_idx.data(), GL_STATIC_DRAW);
+// One shared quad, instanced once per speaker.
+const float marker_scale = 0.12f;
+SpeakerMarkers markers;
+markers.setSpeakers(layout.getPositions(), marker_scale);
 
 glm::mat4 model      = glm::mat4(1.0f);
 glm::mat4 view       = glm::mat4(1.0f);
@@ -150,14 +114,20 @@ while (!glfwWindowShouldClose(window)) {
     ourShader.setMat4("view", view);
     ourShader.setMat4("projection", projection);
 
-    // Set speaker colour.
+    // Set speaker colours.
+    ourShader.setVec3("lightColour", glm::vec3(0.0f, 1.0f, 0.0f));
+    ourShader.setVec3("idleColour", glm::vec3(0.0f, 0.1f, 0.0f));
+
+    // Animate each speaker's level and size; only the instance buffer is re-uploaded.
     double  timeValue = glfwGetTime();
-    float greenValue = static_cast<float>(sin(timeValue) / 2.0 + 0.5);
-    ourShader.setVec3("lightColour", glm::vec3(0.0f, greenValue, 0.0f));
+    for (size_t i = 0; i < markers.size(); ++i) {
+        SpeakerInstance &marker = markers.edit(i);
+        marker.level = static_cast<float>(sin(timeValue + 0.5 * i) / 2.0 + 0.5);
+        marker.positionScale.w = marker_scale * (1.f + 0.5f * marker.level);
+    }
 
-    // Bind VAO and draw
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, all_spkr_vert_idx.size(), GL_UNSIGNED_INT, 0);
+    // Draw every marker in one instanced call.
+    markers.draw();
 
     // Swap buffers and poll events
     glfwSwapBuffers(window);
@@ -165,9 +135,8 @@ while (!glfwWindowShouldClose(window)) {
 }
 
     // Cleanup
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    markers.destroy();
+    glDeleteProgram(ourShader.ID);
 
     glfwTerminate();
 }
@@ -0,0 +1,107 @@
+#ifndef ROOM_VIEWS_H
+#define ROOM_VIEWS_H
+
+#include "uniform_buffer.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The room cameras from docs/notes.md, all looking at the origin from the
+// same distance. "back" is the original single camera (down -z); "top" is the
+// one room_spkrs uses.
+struct RoomView {
+  std::string name;
+  glm::mat4 view;
+};
+
+inline bool findRoomView(const std::string &name, RoomView &out) {
+  const glm::mat4 distance =
+      glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -5.f));
+  const glm::vec3 xAxis(1.f, 0.f, 0.f), yAxis(0.f, 1.f, 0.f);
+  if (name == "back") {
+    out = {name, distance};
+  } else if (name == "side") {
+    out = {name, distance * glm::rotate(glm::mat4(1.f), glm::radians(-90.f),
+                                        yAxis)};
+  } else if (name == "top") {
+    out = {name, distance * glm::rotate(glm::mat4(1.f), glm::radians(90.f),
+                                        xAxis)};
+  } else if (name == "iso") {
+    // Down the (1, 1, 1) diagonal.
+    const float elevation = glm::degrees(std::atan(1.f / std::sqrt(2.f)));
+    out = {name,
+           distance *
+               glm::rotate(glm::mat4(1.f), glm::radians(elevation), xAxis) *
+               glm::rotate(glm::mat4(1.f), glm::radians(-45.f), yAxis)};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Up to kMaxViews cameras tiled over one framebuffer, row-major from the top
+// left in a near-square grid. Everything is drawn into a single viewport:
+// each instance of a draw moves its vertices into its view's tile in clip
+// space and clips against the tile with gl_ClipDistance, since core 3.3 has
+// no per-primitive viewport selection.
+class RoomViews {
+public:
+  // A comma-separated list such as "side,top,back,iso". Unknown names are
+  // reported and skipped; an empty result falls back to "back".
+  RoomViews(const std::string &list, float aspect) {
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+      RoomView view;
+      if (name.empty()) {
+        continue;
+      } else if (!findRoomView(name, view)) {
+        std::cout << "ERROR::VIEWS::UNKNOWN_VIEW: " << name << std::endl;
+      } else if (views.size() == kMaxViews) {
+        std::cout << "ERROR::VIEWS::TOO_MANY_VIEWS: dropping " << name
+                  << std::endl;
+      } else {
+        views.push_back(view);
+      }
+    }
+    if (views.empty()) {
+      views.push_back({});
+      findRoomView("back", views.back());
+    }
+    columns = static_cast<int>(std::ceil(std::sqrt(float(views.size()))));
+    rows = (static_cast<int>(views.size()) + columns - 1) / columns;
+    tileAspect = aspect * rows / columns;
+  }
+
+  size_t size() const { return views.size(); }
+  const RoomView &operator[](size_t i) const { return views[i]; }
+
+  // Fills the Views block; unused entries are left as they are.
+  void fill(ViewUniforms &uniforms) const {
+    const glm::mat4 projection =
+        glm::perspective(glm::radians(45.0f), tileAspect, 0.1f, 100.0f);
+    const glm::vec2 scale(1.f / columns, 1.f / rows);
+    for (size_t i = 0; i < views.size(); ++i) {
+      const int column = static_cast<int>(i) % columns;
+      const int row = static_cast<int>(i) / columns;
+      uniforms.viewProjection[i] = projection * views[i].view;
+      uniforms.tile[i] =
+          glm::vec4(scale, -1.f + (2 * column + 1) * scale.x,
+                    1.f - (2 * row + 1) * scale.y);
+    }
+  }
+
+private:
+  std::vector<RoomView> views;
+  int columns = 1;
+  int rows = 1;
+  float tileAspect = 1.f;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "program_binary_cache.hpp"
+#include "shader_m.h"
+
+#include <glad/glad.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compile-time specialisations of one vertex / fragment pair, keyed by the
+// #define block spliced in after #version. Each permutation is compiled and
+// linked the first time it is asked for and kept until destroy(), so
+// switching back to a layout that was used before costs nothing. With a
+// ProgramBinaryCache, a permutation linked on an earlier run is restored from
+// its binary instead of being compiled.
+class ShaderPermutations {
+public:
+  // `binaryCache` may be null; otherwise it must outlive this object. Every
+  // permutation is linked with the same transform feedback varyings (see
+  // Shader).
+  ShaderPermutations(std::string vertexCode, std::string fragmentCode,
+                     ProgramBinaryCache *binaryCache = nullptr,
+                     std::vector<std::string> feedbackVaryings = {})
+      : kVertexCode(std::move(vertexCode)),
+        kFragmentCode(std::move(fragmentCode)), binaryCache(binaryCache),
+        kFeedbackVaryings(std::move(feedbackVaryings)) {}
+  // Must run while the GL context is still current.
+  void destroy() {
+    for (auto &entry : programs) {
+      glDeleteProgram(entry.second->ID);
+    }
+    programs.clear();
+  }
+
+  ShaderPermutations(const ShaderPermutations &) = delete;
+  ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+  // The program built with `defines`. `init(shader)` runs once, right after a
+  // permutation is linked, to set the uniforms that never change; uniform
+  // state belongs to the program, so cached permutations keep theirs.
+  template <typename Init>
+  Shader &get(const std::string &defines, Init &&init) {
+    auto it = programs.find(defines);
+    if (it == programs.end()) {
+      const std::string vertexCode = spliceDefines(kVertexCode, defines);
+      const std::string fragmentCode = spliceDefines(kFragmentCode, defines);
+      std::unique_ptr<Shader> shader;
+      const GLuint cached =
+          binaryCache ? binaryCache->load(vertexCode, fragmentCode) : 0;
+      if (cached != 0) {
+        shader = std::make_unique<Shader>(cached);
+      } else {
+        shader = std::make_unique<Shader>(vertexCode, fragmentCode, "",
+                                          kFeedbackVaryings);
+        if (binaryCache) {
+          binaryCache->store(shader->ID, vertexCode, fragmentCode);
+        }
+      }
+      shader->use();
+      init(*shader);
+      it = programs.emplace(defines, std::move(shader)).first;
+    }
+    return *it->second;
+  }
+
+  size_t size() const { return programs.size(); }
+
+private:
+  const std::string kVertexCode;
+  const std::string kFragmentCode;
+  ProgramBinaryCache *binaryCache;
+  const std::vector<std::string> kFeedbackVaryings;
+  std::map<std::string, std::unique_ptr<Shader>> programs;
+};
+
+#endif
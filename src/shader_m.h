@@ -1,50 +1,43 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include "program_binary_cache.hpp"
+
 #include <exception>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// `code` with `defines` inserted right after its #version line.
+inline std::string spliceDefines(std::string code,
+                                 const std::string &defines) {
+  if (!defines.empty()) {
+    code.insert(code.find('\n') + 1, defines);
+  }
+  return code;
+}
 
 class Shader {
 public:
   unsigned int ID;
-  // constructor generates the shader on the fly
-  // ------------------------------------------------------------------------
-  Shader(const char *vertexPath, const char *fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-      // open files
-      vShaderFile.open(vertexPath);
-      fShaderFile.open(fragmentPath);
-      std::stringstream vShaderStream, fShaderStream;
-      // read file's buffer contents into streams
-      vShaderStream << vShaderFile.rdbuf();
-      fShaderStream << fShaderFile.rdbuf();
-      // close file handlers
-      vShaderFile.close();
-      fShaderFile.close();
-      // convert stream into string
-      vertexCode = vShaderStream.str();
-      fragmentCode = fShaderStream.str();
-    } catch (std::ifstream::failure &e) {
-      std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what()
-                << std::endl;
-    }
+  // constructor compiles and links the given sources. `defines` (e.g.
+  // "#define N 4\n") is spliced into both stages right after #version. The
+  // driver is asked to keep the linked binary retrievable for
+  // ProgramBinaryCache. `feedbackVaryings` are vertex outputs to capture with
+  // transform feedback, interleaved in the order given.
+  // ------------------------------------------------------------------------
+  Shader(std::string vertexCode, std::string fragmentCode,
+         const std::string &defines = "",
+         const std::vector<std::string> &feedbackVaryings = {}) {
+    vertexCode = spliceDefines(vertexCode, defines);
+    fragmentCode = spliceDefines(fragmentCode, defines);
     const char *vShaderCode = vertexCode.c_str();
     const char *fShaderCode = fragmentCode.c_str();
-    // 2. compile shaders
+    // 1. compile shaders
     unsigned int vertex, fragment;
     // vertex shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -56,81 +49,144 @@ public:
     glShaderSource(fragment, 1, &fShaderCode, NULL);
     glCompileShader(fragment);
     checkCompileErrors(fragment, "FRAGMENT");
-    // shader Program
+    // 2. shader Program
     ID = glCreateProgram();
+    if (programBinaryApi().available) {
+      programBinaryApi().programParameteri(
+          ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    if (!feedbackVaryings.empty()) {
+      std::vector<const char *> names;
+      for (const std::string &name : feedbackVaryings) {
+        names.push_back(name.c_str());
+      }
+      glTransformFeedbackVaryings(ID, names.size(), names.data(),
+                                  GL_INTERLEAVED_ATTRIBS);
+    }
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
     // delete the shaders as they're linked into our program now and no longer
     // necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    cacheUniformLocations();
+  }
+  // Takes ownership of an already linked program, e.g. one restored by
+  // ProgramBinaryCache.
+  // ------------------------------------------------------------------------
+  explicit Shader(GLuint linkedProgram) : ID(linkedProgram) {
+    cacheUniformLocations();
   }
   // activate the shader
   // ------------------------------------------------------------------------
   void use() const { glUseProgram(ID); }
+  // Location resolved at link time, or -1 (which glUniform* ignores) for a
+  // name the program doesn't use. No GL call.
+  // ------------------------------------------------------------------------
+  GLint getUniformLocation(const std::string &name) const {
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
+  }
+  // ------------------------------------------------------------------------
+  void bindUniformBlock(const std::string &name, GLuint bindingPoint) const {
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX) {
+      glUniformBlockBinding(ID, index, bindingPoint);
+    }
+  }
   // utility uniform functions
   // ------------------------------------------------------------------------
   void setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
   }
   // ------------------------------------------------------------------------
   void setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
   }
   // ------------------------------------------------------------------------
   void setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
   }
   void setFloatArray(const std::string &name, const float *values,
                      size_t count) const {
-    glUniform1fv(glGetUniformLocation(ID, name.c_str()), count, values);
+    glUniform1fv(getUniformLocation(name), count, values);
   }
   // ------------------------------------------------------------------------
   void setVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
   }
   void setVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(getUniformLocation(name), x, y);
   }
   // ------------------------------------------------------------------------
   void setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
   }
   void setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
   }
   // ------------------------------------------------------------------------
   void setVec3Array(const std::string &name, const glm::vec3 *values,
                     size_t count) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), count, &values[0][0]);
+    glUniform3fv(getUniformLocation(name), count, &values[0][0]);
   }
   // ------------------------------------------------------------------------
   void setVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(getUniformLocation(name), 1, &value[0]);
   }
   void setVec4(const std::string &name, float x, float y, float z,
                float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(getUniformLocation(name), x, y, z, w);
   }
   // ------------------------------------------------------------------------
   void setMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE,
                        &mat[0][0]);
   }
   // ------------------------------------------------------------------------
   void setMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE,
                        &mat[0][0]);
   }
   // ------------------------------------------------------------------------
   void setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
                        &mat[0][0]);
   }
 
 private:
+  std::unordered_map<std::string, GLint> uniformLocations;
+
+  // Looks up every active uniform once after linking so the setters never
+  // have to ask the driver. Arrays are reported as "name[0]" and are stored
+  // under "name" as well.
+  // ------------------------------------------------------------------------
+  void cacheUniformLocations() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength, '\0');
+    for (GLint i = 0; i < count; ++i) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+      const std::string uniform = name.substr(0, length);
+      // Members of uniform blocks have no location.
+      GLint location = glGetUniformLocation(ID, uniform.c_str());
+      if (location < 0) {
+        continue;
+      }
+      uniformLocations[uniform] = location;
+      const size_t bracket = uniform.find("[0]");
+      if (bracket != std::string::npos) {
+        uniformLocations[uniform.substr(0, bracket)] = location;
+      }
+    }
+  }
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(GLuint shader, std::string type) {
@@ -0,0 +1,37 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include "embedded_shaders.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// GLSL source of the shader file `name` (e.g. "room.vs"). With an empty
+// `dir` it is the copy embedded at build time, so the binary runs from any
+// directory without touching the disk; otherwise it is read from `dir`, for
+// editing shaders without rebuilding.
+inline std::string loadShaderSource(const std::string &dir,
+                                    const std::string &name) {
+  if (dir.empty()) {
+    for (const EmbeddedShader &shader : kEmbeddedShaders) {
+      if (shader.name == name) {
+        return std::string(shader.source);
+      }
+    }
+    std::cout << "ERROR::SHADER::NOT_EMBEDDED: " << name << std::endl;
+    return "";
+  }
+  std::ifstream file(dir + "/" + name);
+  if (!file) {
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << dir << "/"
+              << name << std::endl;
+    return "";
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  return stream.str();
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef SHARD_MERGER_H
+#define SHARD_MERGER_H
+
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+
+// Puts the frames of a sharded render back in timeline order. The timeline
+// is dealt out round-robin in chunks of kChunkFrames: frame f belongs to
+// shard (f / kChunkFrames) % numShards, and each shard writes its frames, in
+// order, to its own pipe.
+//
+// Each shard may run at most `maxBuffered` frames ahead of the output; past
+// that its pipe isn't read, so a shard that races ahead blocks on write
+// instead of growing the buffer. A chunk's worth is enough for every shard to
+// render its next chunk while the others' are being written out.
+class ShardMerger {
+public:
+  static constexpr long kChunkFrames = 8;
+
+  static int shardOf(long frame, int numShards) {
+    return static_cast<int>((frame / kChunkFrames) % numShards);
+  }
+
+  // Takes ownership of the read ends in `fds`.
+  ShardMerger(std::vector<int> fds, size_t frameBytes,
+              size_t maxBuffered = kChunkFrames)
+      : kFrameBytes(frameBytes), kMaxBuffered(maxBuffered),
+        shards(fds.size()) {
+    for (size_t i = 0; i < fds.size(); ++i) {
+      shards[i].fd = fds[i];
+    }
+  }
+  ~ShardMerger() {
+    for (Shard &shard : shards) {
+      if (shard.fd >= 0) {
+        ::close(shard.fd);
+      }
+    }
+  }
+
+  ShardMerger(const ShardMerger &) = delete;
+  ShardMerger &operator=(const ShardMerger &) = delete;
+
+  // Calls consume(rgba) for frames [0, numFrames) in order. Returns false if
+  // consume fails or a shard's output ends before its last frame (the shard
+  // failed); frames up to that point have been consumed.
+  template <typename Consume> bool run(long numFrames, Consume &&consume) {
+    for (long frame = 0; frame < numFrames; ++frame) {
+      Shard &shard = shards[shardOf(frame, shards.size())];
+      while (shard.frames.empty()) {
+        if (shard.fd < 0 || !fill()) {
+          return false;
+        }
+      }
+      const bool ok = consume(shard.frames.front().data());
+      spare.push_back(std::move(shard.frames.front()));
+      shard.frames.pop_front();
+      if (!ok) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  struct Shard {
+    int fd = -1;
+    std::deque<std::vector<uint8_t>> frames;
+    std::vector<uint8_t> partial;
+    size_t filled = 0;
+  };
+
+  // Waits until some shard with room has output and reads what it can.
+  // False on a poll error or when no shard is left to read from.
+  bool fill() {
+    std::vector<pollfd> fds;
+    std::vector<Shard *> polled;
+    for (Shard &shard : shards) {
+      if (shard.fd >= 0 && shard.frames.size() < kMaxBuffered) {
+        fds.push_back({shard.fd, POLLIN, 0});
+        polled.push_back(&shard);
+      }
+    }
+    if (fds.empty()) {
+      return false;
+    }
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+      return errno == EINTR;
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+      if (fds[i].revents != 0) {
+        read(*polled[i]);
+      }
+    }
+    return true;
+  }
+
+  void read(Shard &shard) {
+    if (shard.partial.empty()) {
+      if (spare.empty()) {
+        shard.partial.resize(kFrameBytes);
+      } else {
+        shard.partial = std::move(spare.back());
+        spare.pop_back();
+      }
+      shard.filled = 0;
+    }
+    const ssize_t n = ::read(shard.fd, shard.partial.data() + shard.filled,
+                             kFrameBytes - shard.filled);
+    if (n <= 0) {
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return;
+      }
+      // Done (or failed); run() notices if frames are still owed.
+      ::close(shard.fd);
+      shard.fd = -1;
+      return;
+    }
+    shard.filled += n;
+    if (shard.filled == kFrameBytes) {
+      shard.frames.push_back(std::move(shard.partial));
+      shard.partial.clear();
+    }
+  }
+
+  const size_t kFrameBytes;
+  const size_t kMaxBuffered;
+  std::vector<Shard> shards;
+  // Buffers of consumed frames, reused so steady state doesn't allocate.
+  std::vector<std::vector<uint8_t>> spare;
+};
+
+#endif
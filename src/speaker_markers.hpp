@@ -0,0 +1,139 @@
+#ifndef SPEAKER_MARKERS_H
+#define SPEAKER_MARKERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Per-instance attributes of spkr.vs, one per speaker.
+struct SpeakerInstance {
+  glm::vec4 positionScale; // xyz: marker centre, w: edge length
+  glm::vec4 orientation;   // quaternion (x, y, z, w) turning the quad's +z
+                           // face towards the listener
+  float level;             // 0..1, mixes the marker colour
+};
+
+// Speaker markers drawn as instances of one shared quad. The quad mesh is
+// uploaded once; each speaker is a SpeakerInstance in a small buffer that
+// edit() marks dirty and draw() re-uploads in one glBufferSubData, so
+// animating levels or scales never touches the mesh. Like the other GL
+// wrappers it is destroyed explicitly while the context is current.
+class SpeakerMarkers {
+public:
+  // Attribute locations in spkr.vs.
+  static constexpr GLuint kMeshAttrib = 0;
+  static constexpr GLuint kPositionScaleAttrib = 1;
+  static constexpr GLuint kOrientationAttrib = 2;
+  static constexpr GLuint kLevelAttrib = 3;
+
+  SpeakerMarkers() {
+    // Unit quad facing +z, as two triangles sharing an edge.
+    static const float kQuad[] = {
+        -0.5f, -0.5f, 0.f, //
+        0.5f,  -0.5f, 0.f, //
+        -0.5f, 0.5f,  0.f, //
+        0.5f,  0.5f,  0.f,
+    };
+    static const GLuint kQuadIdx[] = {0, 1, 2, 1, 2, 3};
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &meshBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &instanceBuffer);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(kQuad), kQuad, GL_STATIC_DRAW);
+    glVertexAttribPointer(kMeshAttrib, 3, GL_FLOAT, GL_FALSE,
+                          3 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(kMeshAttrib);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(kQuadIdx), kQuadIdx,
+                 GL_STATIC_DRAW);
+
+    // Instance attributes advance once per marker instead of per vertex.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    const GLsizei stride = sizeof(SpeakerInstance);
+    glVertexAttribPointer(kPositionScaleAttrib, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(SpeakerInstance, positionScale));
+    glVertexAttribPointer(kOrientationAttrib, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(SpeakerInstance, orientation));
+    glVertexAttribPointer(kLevelAttrib, 1, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(SpeakerInstance, level));
+    for (GLuint attrib :
+         {kPositionScaleAttrib, kOrientationAttrib, kLevelAttrib}) {
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribDivisor(attrib, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  void destroy() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &meshBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    VAO = meshBuffer = indexBuffer = instanceBuffer = 0;
+  }
+
+  SpeakerMarkers(const SpeakerMarkers &) = delete;
+  SpeakerMarkers &operator=(const SpeakerMarkers &) = delete;
+
+  // One marker per speaker at `positions`, each `scale` across and facing
+  // the origin, with level 0. Reallocates the instance buffer.
+  void setSpeakers(const std::vector<glm::vec3> &positions, float scale) {
+    instances.clear();
+    for (const glm::vec3 &p : positions) {
+      const glm::vec3 dir = glm::normalize(p);
+      // quatLookAt turns -z onto dir, so the quad's +z face looks back at
+      // the origin. Straight up or down needs another up vector.
+      const glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f)
+                                                   : glm::vec3(0.f, 1.f, 0.f);
+      const glm::quat q = glm::quatLookAt(dir, up);
+      instances.push_back(
+          {glm::vec4(p, scale), glm::vec4(q.x, q.y, q.z, q.w), 0.f});
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SpeakerInstance),
+                 instances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirty = false;
+  }
+
+  size_t size() const { return instances.size(); }
+  const SpeakerInstance &get(size_t i) const { return instances[i]; }
+  SpeakerInstance &edit(size_t i) {
+    dirty = true;
+    return instances[i];
+  }
+
+  // Uploads edited instances, then draws every marker in one call.
+  void draw() {
+    if (dirty) {
+      glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+      glBufferSubData(GL_ARRAY_BUFFER, 0,
+                      instances.size() * sizeof(SpeakerInstance),
+                      instances.data());
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      dirty = false;
+    }
+    glBindVertexArray(VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0,
+                            instances.size());
+  }
+
+private:
+  GLuint VAO = 0;
+  GLuint meshBuffer = 0;
+  GLuint indexBuffer = 0;
+  GLuint instanceBuffer = 0;
+  std::vector<SpeakerInstance> instances;
+  bool dirty = false;
+};
+
+#endif
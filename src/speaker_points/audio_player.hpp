@@ -0,0 +1,158 @@
+#ifndef AUDIO_PLAYER_H
+#define AUDIO_PLAYER_H
+
+#include "audio_sink.hpp"
+#include "wav_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// How far the wall clock strays from the playback clock over a run. The old
+// setup (afplay in the background, visuals on glfwGetTime()) silently had all
+// of this as A/V error.
+struct SkewStats {
+  // Wall time from start() until the playback clock started moving.
+  double startup_s = 0;
+  // Wall clock minus playback clock, after removing the startup offset.
+  double meanSkew_s = 0;
+  double maxAbsSkew_s = 0;
+  // Least-squares slope of the skew, in parts per million.
+  double drift_ppm = 0;
+};
+
+// Plays a WAV file through an AudioSink on its own thread and exposes a
+// playback clock derived from the number of frames the sink has consumed. The
+// clock only advances as the sink takes audio, so anything scheduled on it
+// stays locked to what is being heard.
+class AudioPlayer {
+public:
+  static constexpr size_t kBlockFrames = 256;
+
+  AudioPlayer(const std::string &path, const std::string &sinkSpec,
+              float latency_s = 0.1f)
+      : reader(path, kBlockFrames * 64), kSampleRate(reader.getSampleRate()) {
+    sink = makeAudioSink(sinkSpec, reader.getNumChannels(), kSampleRate,
+                         latency_s);
+  }
+
+  ~AudioPlayer() {
+    running = false;
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  AudioPlayer(const AudioPlayer &) = delete;
+  AudioPlayer &operator=(const AudioPlayer &) = delete;
+
+  void start() {
+    startTime = std::chrono::steady_clock::now();
+    worker = std::thread([this] { run(); });
+  }
+
+  // Playback clock: seconds of audio the sink has made audible. Steps once per
+  // block (kBlockFrames), well below the epoch length.
+  float time_s() const {
+    const int64_t audible =
+        static_cast<int64_t>(framesConsumed.load(std::memory_order_acquire)) -
+        static_cast<int64_t>(latencyFrames.load(std::memory_order_relaxed));
+    return kSampleRate > 0 ? std::max<int64_t>(audible, 0) / kSampleRate : 0.f;
+  }
+
+  bool isFinished() const { return finished.load(); }
+
+  SkewStats getSkewStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    SkewStats stats;
+    if (numSamples == 0) {
+      return stats;
+    }
+    stats.startup_s = startup_s;
+    stats.meanSkew_s = sumSkew / numSamples;
+    stats.maxAbsSkew_s = maxAbsSkew;
+    const double denom = numSamples * sumTT - sumT * sumT;
+    if (denom > 0) {
+      stats.drift_ppm =
+          1e6 * (numSamples * sumTSkew - sumT * sumSkew) / denom;
+    }
+    return stats;
+  }
+
+private:
+  void run() {
+    std::vector<std::vector<float>> planar;
+    std::vector<float> interleaved;
+    const int numChannels = reader.getNumChannels();
+    const size_t total = reader.getNumSamplesPerChannel();
+    size_t pos = 0;
+    latencyFrames = sink->latencyFrames();
+    while (running && pos < total) {
+      const size_t n = reader.readPlanar(pos, kBlockFrames, planar);
+      interleaved.resize(n * numChannels);
+      for (size_t i = 0; i < n; ++i) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+          interleaved[i * numChannels + ch] = planar[ch][i];
+        }
+      }
+      if (sink->write(interleaved.data(), n) < n) {
+        std::cout << "ERROR::AUDIO_PLAYER::SINK_FAILED, continuing silently"
+                  << std::endl;
+        sink = std::make_unique<NullSink>(kSampleRate, sink->latencyFrames());
+        latencyFrames = sink->latencyFrames();
+        continue;
+      }
+      pos += n;
+      framesConsumed.store(pos, std::memory_order_release);
+      recordSkew();
+    }
+    finished = true;
+  }
+
+  void recordSkew() {
+    const double wall = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - startTime)
+                            .count();
+    const double audio = time_s();
+    // Only once the sink's buffer has filled does the clock track audible
+    // output; before that it is pinned at zero.
+    if (audio <= 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (numSamples == 0) {
+      // Wall time at which the playback clock read zero.
+      startup_s = wall - audio;
+    }
+    const double skew = wall - startup_s - audio;
+    ++numSamples;
+    sumT += audio;
+    sumTT += audio * audio;
+    sumSkew += skew;
+    sumTSkew += audio * skew;
+    maxAbsSkew = std::max(maxAbsSkew, std::abs(skew));
+  }
+
+  WavReader reader;
+  const float kSampleRate;
+  std::unique_ptr<AudioSink> sink;
+  std::thread worker;
+  std::atomic<bool> running{true};
+  std::atomic<bool> finished{false};
+  std::atomic<size_t> framesConsumed{0};
+  std::atomic<size_t> latencyFrames{0};
+  std::chrono::steady_clock::time_point startTime;
+
+  mutable std::mutex statsMutex;
+  double startup_s = 0;
+  size_t numSamples = 0;
+  double sumT = 0, sumTT = 0, sumSkew = 0, sumTSkew = 0, maxAbsSkew = 0;
+};
+
+#endif
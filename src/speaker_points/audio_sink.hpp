@@ -0,0 +1,148 @@
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Destination for decoded, interleaved float32 frames. write() blocks for as
+// long as the sink needs to make room, which is what paces the AudioPlayer and
+// therefore the playback clock.
+class AudioSink {
+public:
+  virtual ~AudioSink() = default;
+  // Returns the number of frames accepted; fewer than numFrames means the sink
+  // has failed.
+  virtual size_t write(const float *frames, size_t numFrames) = 0;
+  // Frames accepted but not yet audible.
+  virtual size_t latencyFrames() const { return 0; }
+};
+
+// Discards audio but consumes it at the sample rate, behaving like a device
+// with a buffer of bufferFrames. Stands in for hardware on headless machines.
+class NullSink : public AudioSink {
+public:
+  NullSink(float sampleRate, size_t bufferFrames = 1024)
+      : kSampleRate(sampleRate), kBufferFrames(bufferFrames) {}
+
+  size_t write(const float *, size_t numFrames) override {
+    if (framesWritten == 0) {
+      start = std::chrono::steady_clock::now();
+    }
+    framesWritten += numFrames;
+    if (framesWritten > kBufferFrames) {
+      const std::chrono::duration<double> played(
+          (framesWritten - kBufferFrames) / kSampleRate);
+      std::this_thread::sleep_until(
+          start +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              played));
+    }
+    return numFrames;
+  }
+  size_t latencyFrames() const override { return kBufferFrames; }
+
+private:
+  const double kSampleRate;
+  const size_t kBufferFrames;
+  size_t framesWritten = 0;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Writes raw interleaved float32 to a file as fast as it is given, for offline
+// runs and tests where wall-clock pacing is unwanted.
+class FileSink : public AudioSink {
+public:
+  FileSink(const std::string &path, int numChannels)
+      : kNumChannels(numChannels), file(std::fopen(path.c_str(), "wb")) {}
+  ~FileSink() override {
+    if (file != nullptr) {
+      std::fclose(file);
+    }
+  }
+
+  size_t write(const float *frames, size_t numFrames) override {
+    if (file == nullptr) {
+      return 0;
+    }
+    return std::fwrite(frames, sizeof(float) * kNumChannels, numFrames, file);
+  }
+
+private:
+  const int kNumChannels;
+  FILE *file;
+};
+
+// Streams raw float32 into the stdin of a command-line player (aplay, sox's
+// play, ...). The pipe and the player's own buffer provide back-pressure, so
+// the clock follows the device; latencyFrames should cover that buffering.
+class PipeSink : public AudioSink {
+public:
+  PipeSink(const std::string &command, int numChannels, size_t latencyFrames)
+      : kNumChannels(numChannels), kLatencyFrames(latencyFrames) {
+    // A player that exits early must surface as a short write, not kill us.
+    std::signal(SIGPIPE, SIG_IGN);
+    pipe = ::popen(command.c_str(), "w");
+  }
+  ~PipeSink() override {
+    if (pipe != nullptr) {
+      ::pclose(pipe);
+    }
+  }
+
+  size_t write(const float *frames, size_t numFrames) override {
+    if (pipe == nullptr) {
+      return 0;
+    }
+    const size_t written =
+        std::fwrite(frames, sizeof(float) * kNumChannels, numFrames, pipe);
+    // fwrite only fills stdio's buffer; a dead player shows up on the flush.
+    return std::fflush(pipe) == 0 ? written : 0;
+  }
+  size_t latencyFrames() const override { return kLatencyFrames; }
+
+  // Player command for raw little-endian float32 on stdin.
+  static std::string defaultCommand(int numChannels, float sampleRate) {
+    const std::string ch = std::to_string(numChannels);
+    const std::string sr = std::to_string(static_cast<int>(sampleRate));
+#ifdef __APPLE__
+    return "play -q -t raw -e floating-point -b 32 -c " + ch + " -r " + sr +
+           " - 2>/dev/null";
+#else
+    return "aplay -q -t raw -f FLOAT_LE -c " + ch + " -r " + sr +
+           " 2>/dev/null";
+#endif
+  }
+
+private:
+  const int kNumChannels;
+  const size_t kLatencyFrames;
+  FILE *pipe = nullptr;
+};
+
+// Builds a sink from a spec string: "null", "file:<path>", "pipe:<command>" or
+// "auto" (the platform's default player through a PipeSink).
+inline std::unique_ptr<AudioSink> makeAudioSink(const std::string &spec,
+                                                int numChannels,
+                                                float sampleRate,
+                                                float latency_s = 0.1f) {
+  const size_t latencyFrames = static_cast<size_t>(latency_s * sampleRate);
+  if (spec.rfind("file:", 0) == 0) {
+    return std::make_unique<FileSink>(spec.substr(5), numChannels);
+  }
+  if (spec.rfind("pipe:", 0) == 0) {
+    return std::make_unique<PipeSink>(spec.substr(5), numChannels,
+                                      latencyFrames);
+  }
+  if (spec == "auto") {
+    return std::make_unique<PipeSink>(
+        PipeSink::defaultCommand(numChannels, sampleRate), numChannels,
+        latencyFrames);
+  }
+  return std::make_unique<NullSink>(sampleRate, latencyFrames);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef BAND_ENERGY_H
+#define BAND_ENERGY_H
+
+#include "real_fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Splits one epoch of one channel into frequency bands and reports each band's
+// level in the same units as the broadband value (|dB| of mean square). The
+// epoch is Hann-windowed and zero-padded to a power of two; band powers are
+// normalised by the window energy so the bands of a full-scale signal add up
+// to its broadband mean square.
+class BandAnalyzer {
+public:
+  // bandSplits_hz are the crossover frequencies between bands, ascending. N
+  // splits give N + 1 bands, the first starting at DC and the last ending at
+  // Nyquist.
+  BandAnalyzer(float sampleRate, size_t maxSamples,
+               const std::vector<float> &bandSplits_hz)
+      : fft(fftSizeFor(maxSamples)), padded(fft.size(), 0.f),
+        power(fft.numBins()) {
+    const float binHz = sampleRate / fft.size();
+    bandFirstBin.push_back(0);
+    for (float split : bandSplits_hz) {
+      const size_t bin = std::clamp<size_t>(
+          static_cast<size_t>(std::lround(split / binHz)), bandFirstBin.back(),
+          fft.numBins());
+      bandFirstBin.push_back(bin);
+    }
+    bandFirstBin.push_back(fft.numBins());
+  }
+
+  size_t getNumBands() const { return bandFirstBin.size() - 1; }
+
+  // Analyses `count` samples (at most maxSamples) into getNumBands() values.
+  void analyze(const float *samples, size_t count, float *bandDbs) {
+    count = std::min(count, fft.size());
+    if (count != windowLength) {
+      // Only the last, short epoch of a track needs a different window.
+      window.resize(count);
+      windowEnergy = 0.0;
+      for (size_t i = 0; i < count; ++i) {
+        window[i] = count > 1 ? static_cast<float>(
+                                    0.5 - 0.5 * std::cos(2.0 * M_PI * i /
+                                                         (count - 1)))
+                              : 1.f;
+        windowEnergy += static_cast<double>(window[i]) * window[i];
+      }
+      windowLength = count;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      padded[i] = samples[i] * window[i];
+    }
+    std::fill(padded.begin() + count, padded.end(), 0.f);
+    fft.powerSpectrum(padded.data(), power.data());
+
+    // Parseval over the one-sided spectrum: interior bins count twice.
+    const size_t nyquist = fft.numBins() - 1;
+    const double norm = 1.0 / (static_cast<double>(fft.size()) * windowEnergy);
+    for (size_t b = 0; b < getNumBands(); ++b) {
+      double sum = 0.0;
+      for (size_t k = bandFirstBin[b]; k < bandFirstBin[b + 1]; ++k) {
+        sum += (k == 0 || k == nyquist) ? power[k] : 2.0 * power[k];
+      }
+      bandDbs[b] = std::abs(static_cast<float>(10 * std::log10(sum * norm)));
+    }
+  }
+
+private:
+  static size_t fftSizeFor(size_t samples) {
+    size_t n = 2;
+    while (n < samples) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  RealFft fft;
+  std::vector<float> padded;
+  std::vector<float> power;
+  std::vector<size_t> bandFirstBin;
+  std::vector<float> window;
+  size_t windowLength = 0;
+  double windowEnergy = 0.0;
+};
+
+#endif
@@ -0,0 +1,436 @@
+#ifndef DISPLACEMENT_ENGINE_H
+#define DISPLACEMENT_ENGINE_H
+
+#include "../uniform_buffer.hpp"
+#include "../worker_pool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DISPLACEMENT_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DISPLACEMENT_NEON 1
+#endif
+
+// CPU version of the sinc-wave displacement in room.vs. Every point is pushed
+// along its direction by
+//   maxOverallDisplacement * sum_i amplitude_i * 3 * sinc(freq_i * angle_i)
+// where angle_i is the geodesic distance to speaker i. The scalar kernel
+// evaluates the model exactly (acos and sin, as room.vs did before it read
+// baked angles and a sinc table) and is the reference; the vector kernels
+// replace acos and sin with polynomials accurate to a few float ulps. Close to
+// a speaker acos amplifies the rounding of the dot product, so comparisons
+// against the reference (or the GPU) need an absolute tolerance that grows
+// with the ripple frequency.
+
+// Unit directions and radii of the undisplaced points, one array per
+// component.
+struct DisplacementInput {
+  const float *dirX, *dirY, *dirZ, *radius;
+};
+
+// Displaced positions and the signed displacement, one array per component.
+struct DisplacementOutput {
+  float *x, *y, *z, *displacement;
+};
+
+// Per-frame speaker terms, resolved from FrameUniforms once per frame.
+struct DisplacementTerms {
+  std::vector<float> posX, posY, posZ; // Unit speaker directions.
+  std::vector<float> weight;           // 3 * amplitude: the sinc peak height.
+  std::vector<float> frequency;        // Spatial frequency of the ripple.
+  float scale = 0.f;                   // maxOverallDisplacement.
+};
+
+// Normalized sinc exactly as room.vs writes it.
+inline float shaderSinc(float x) {
+  const float PI = 3.14159265359f;
+  if (std::abs(x) < 1e-5f) {
+    return 1.f;
+  }
+  return std::sin(PI * x) / (PI * x);
+}
+
+// sinc(x) sampled `resolution` times per unit x over [0, range], for the
+// table room.vs interpolates. Linear interpolation between samples is off by
+// at most about 0.41 / resolution^2 (sinc'' peaks at pi^2 / 3).
+inline std::vector<float> sincTable(float range, float resolution) {
+  const size_t numSamples = static_cast<size_t>(range * resolution) + 1;
+  std::vector<float> table(numSamples);
+  for (size_t i = 0; i < numSamples; ++i) {
+    const double x = M_PI * i / resolution;
+    table[i] = i == 0 ? 1.f : static_cast<float>(std::sin(x) / x);
+  }
+  return table;
+}
+
+// Reference implementation; the vector kernels are checked against it.
+inline void displaceScalar(const DisplacementInput &in, size_t begin,
+                           size_t end, const DisplacementTerms &terms,
+                           const DisplacementOutput &out) {
+  const size_t numSpkrs = terms.weight.size();
+  for (size_t i = begin; i < end; ++i) {
+    float sum = 0.f;
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      float d = in.dirX[i] * terms.posX[s] + in.dirY[i] * terms.posY[s] +
+                in.dirZ[i] * terms.posZ[s];
+      d = std::clamp(d, -1.f, 1.f);
+      const float angle = std::acos(d);
+      sum += terms.weight[s] * shaderSinc(terms.frequency[s] * angle);
+    }
+    sum *= terms.scale;
+    const float r = in.radius[i] + sum;
+    out.x[i] = in.dirX[i] * r;
+    out.y[i] = in.dirY[i] * r;
+    out.z[i] = in.dirZ[i] * r;
+    out.displacement[i] = sum;
+  }
+}
+
+// Polynomial constants shared by the vector kernels.
+// acos(x) = sqrt(1 - x) * P(x) on [0, 1], |error| < 2e-8 (Abramowitz &
+// Stegun 4.4.46); negative x uses acos(-x) = pi - acos(x).
+constexpr float kAcosCoeffs[8] = {1.5707963050f,  -0.2145988016f,
+                                  0.0889789874f,  -0.0501743046f,
+                                  0.0308918810f,  -0.0170881256f,
+                                  0.0066700901f,  -0.0012624911f};
+// sin(pi r) = r * Q(r^2) on [-1/2, 1/2] (Taylor to r^11, error < 6e-8).
+// sin(pi x) itself reduces exactly: x = k + r with k = round(x), and
+// sin(pi x) = (-1)^k sin(pi r).
+constexpr float kSinPiCoeffs[6] = {3.14159265f,  -5.16771278f,
+                                   2.55016404f,  -0.599264530f,
+                                   0.0821458866f, -0.00737043095f};
+constexpr float kPi = 3.14159265359f;
+
+#ifdef DISPLACEMENT_X86
+__attribute__((target("avx2,fma"))) inline __m256 acosAvx2(__m256 x) {
+  const __m256 signMask = _mm256_set1_ps(-0.f);
+  const __m256 ax = _mm256_andnot_ps(signMask, x);
+  __m256 p = _mm256_set1_ps(kAcosCoeffs[7]);
+  for (int c = 6; c >= 0; --c) {
+    p = _mm256_fmadd_ps(p, ax, _mm256_set1_ps(kAcosCoeffs[c]));
+  }
+  const __m256 r =
+      _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.f), ax)), p);
+  const __m256 negative = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+  return _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(kPi), r), negative);
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 sincAvx2(__m256 x) {
+  const __m256 k =
+      _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  const __m256 r = _mm256_sub_ps(x, k);
+  const __m256 r2 = _mm256_mul_ps(r, r);
+  __m256 q = _mm256_set1_ps(kSinPiCoeffs[5]);
+  for (int c = 4; c >= 0; --c) {
+    q = _mm256_fmadd_ps(q, r2, _mm256_set1_ps(kSinPiCoeffs[c]));
+  }
+  // Odd k flips the sign.
+  const __m256 sign = _mm256_castsi256_ps(
+      _mm256_slli_epi32(_mm256_cvtps_epi32(k), 31));
+  const __m256 sinPi = _mm256_xor_ps(_mm256_mul_ps(r, q), sign);
+  const __m256 sinc =
+      _mm256_div_ps(sinPi, _mm256_mul_ps(_mm256_set1_ps(kPi), x));
+  const __m256 ax = _mm256_andnot_ps(_mm256_set1_ps(-0.f), x);
+  const __m256 tiny = _mm256_cmp_ps(ax, _mm256_set1_ps(1e-5f), _CMP_LT_OQ);
+  return _mm256_blendv_ps(sinc, _mm256_set1_ps(1.f), tiny);
+}
+
+__attribute__((target("avx2,fma"))) inline void
+displaceAvx2(const DisplacementInput &in, size_t begin, size_t end,
+             const DisplacementTerms &terms, const DisplacementOutput &out) {
+  const size_t numSpkrs = terms.weight.size();
+  const __m256 one = _mm256_set1_ps(1.f), minusOne = _mm256_set1_ps(-1.f);
+  const __m256 scale = _mm256_set1_ps(terms.scale);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    const __m256 dx = _mm256_loadu_ps(in.dirX + i);
+    const __m256 dy = _mm256_loadu_ps(in.dirY + i);
+    const __m256 dz = _mm256_loadu_ps(in.dirZ + i);
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      __m256 d = _mm256_mul_ps(dx, _mm256_set1_ps(terms.posX[s]));
+      d = _mm256_fmadd_ps(dy, _mm256_set1_ps(terms.posY[s]), d);
+      d = _mm256_fmadd_ps(dz, _mm256_set1_ps(terms.posZ[s]), d);
+      d = _mm256_min_ps(_mm256_max_ps(d, minusOne), one);
+      const __m256 angle = acosAvx2(d);
+      const __m256 sinc =
+          sincAvx2(_mm256_mul_ps(_mm256_set1_ps(terms.frequency[s]), angle));
+      sum = _mm256_fmadd_ps(_mm256_set1_ps(terms.weight[s]), sinc, sum);
+    }
+    sum = _mm256_mul_ps(sum, scale);
+    const __m256 r = _mm256_add_ps(_mm256_loadu_ps(in.radius + i), sum);
+    _mm256_storeu_ps(out.x + i, _mm256_mul_ps(dx, r));
+    _mm256_storeu_ps(out.y + i, _mm256_mul_ps(dy, r));
+    _mm256_storeu_ps(out.z + i, _mm256_mul_ps(dz, r));
+    _mm256_storeu_ps(out.displacement + i, sum);
+  }
+  displaceScalar(in, i, end, terms, out);
+}
+
+__attribute__((target("avx512f"))) inline __m512 acosAvx512(__m512 x) {
+  const __m512 ax = _mm512_abs_ps(x);
+  __m512 p = _mm512_set1_ps(kAcosCoeffs[7]);
+  for (int c = 6; c >= 0; --c) {
+    p = _mm512_fmadd_ps(p, ax, _mm512_set1_ps(kAcosCoeffs[c]));
+  }
+  const __m512 r =
+      _mm512_mul_ps(_mm512_sqrt_ps(_mm512_sub_ps(_mm512_set1_ps(1.f), ax)), p);
+  const __mmask16 negative =
+      _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ);
+  return _mm512_mask_sub_ps(r, negative, _mm512_set1_ps(kPi), r);
+}
+
+__attribute__((target("avx512f"))) inline __m512 sincAvx512(__m512 x) {
+  const __m512 k = _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT);
+  const __m512 r = _mm512_sub_ps(x, k);
+  const __m512 r2 = _mm512_mul_ps(r, r);
+  __m512 q = _mm512_set1_ps(kSinPiCoeffs[5]);
+  for (int c = 4; c >= 0; --c) {
+    q = _mm512_fmadd_ps(q, r2, _mm512_set1_ps(kSinPiCoeffs[c]));
+  }
+  const __m512i sign = _mm512_slli_epi32(_mm512_cvtps_epi32(k), 31);
+  const __m512 sinPi = _mm512_castsi512_ps(
+      _mm512_xor_si512(_mm512_castps_si512(_mm512_mul_ps(r, q)), sign));
+  const __m512 sinc =
+      _mm512_div_ps(sinPi, _mm512_mul_ps(_mm512_set1_ps(kPi), x));
+  const __mmask16 tiny = _mm512_cmp_ps_mask(
+      _mm512_abs_ps(x), _mm512_set1_ps(1e-5f), _CMP_LT_OQ);
+  return _mm512_mask_blend_ps(tiny, sinc, _mm512_set1_ps(1.f));
+}
+
+__attribute__((target("avx512f"))) inline void
+displaceAvx512(const DisplacementInput &in, size_t begin, size_t end,
+               const DisplacementTerms &terms, const DisplacementOutput &out) {
+  const size_t numSpkrs = terms.weight.size();
+  const __m512 one = _mm512_set1_ps(1.f), minusOne = _mm512_set1_ps(-1.f);
+  const __m512 scale = _mm512_set1_ps(terms.scale);
+  for (size_t i = begin; i < end; i += 16) {
+    // Masked loads and stores cover the tail without a scalar loop.
+    const size_t rem = std::min<size_t>(end - i, 16);
+    const __mmask16 mask = static_cast<__mmask16>((1u << rem) - 1);
+    const __m512 dx = _mm512_maskz_loadu_ps(mask, in.dirX + i);
+    const __m512 dy = _mm512_maskz_loadu_ps(mask, in.dirY + i);
+    const __m512 dz = _mm512_maskz_loadu_ps(mask, in.dirZ + i);
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      __m512 d = _mm512_mul_ps(dx, _mm512_set1_ps(terms.posX[s]));
+      d = _mm512_fmadd_ps(dy, _mm512_set1_ps(terms.posY[s]), d);
+      d = _mm512_fmadd_ps(dz, _mm512_set1_ps(terms.posZ[s]), d);
+      d = _mm512_min_ps(_mm512_max_ps(d, minusOne), one);
+      const __m512 angle = acosAvx512(d);
+      const __m512 sinc = sincAvx512(
+          _mm512_mul_ps(_mm512_set1_ps(terms.frequency[s]), angle));
+      sum = _mm512_fmadd_ps(_mm512_set1_ps(terms.weight[s]), sinc, sum);
+    }
+    sum = _mm512_mul_ps(sum, scale);
+    const __m512 r =
+        _mm512_add_ps(_mm512_maskz_loadu_ps(mask, in.radius + i), sum);
+    _mm512_mask_storeu_ps(out.x + i, mask, _mm512_mul_ps(dx, r));
+    _mm512_mask_storeu_ps(out.y + i, mask, _mm512_mul_ps(dy, r));
+    _mm512_mask_storeu_ps(out.z + i, mask, _mm512_mul_ps(dz, r));
+    _mm512_mask_storeu_ps(out.displacement + i, mask, sum);
+  }
+}
+#endif
+
+#ifdef DISPLACEMENT_NEON
+inline float32x4_t acosNeon(float32x4_t x) {
+  const float32x4_t ax = vabsq_f32(x);
+  float32x4_t p = vdupq_n_f32(kAcosCoeffs[7]);
+  for (int c = 6; c >= 0; --c) {
+    p = vfmaq_f32(vdupq_n_f32(kAcosCoeffs[c]), p, ax);
+  }
+  const float32x4_t r =
+      vmulq_f32(vsqrtq_f32(vsubq_f32(vdupq_n_f32(1.f), ax)), p);
+  const uint32x4_t negative = vcltq_f32(x, vdupq_n_f32(0.f));
+  return vbslq_f32(negative, vsubq_f32(vdupq_n_f32(kPi), r), r);
+}
+
+inline float32x4_t sincNeon(float32x4_t x) {
+  const float32x4_t k = vrndnq_f32(x);
+  const float32x4_t r = vsubq_f32(x, k);
+  const float32x4_t r2 = vmulq_f32(r, r);
+  float32x4_t q = vdupq_n_f32(kSinPiCoeffs[5]);
+  for (int c = 4; c >= 0; --c) {
+    q = vfmaq_f32(vdupq_n_f32(kSinPiCoeffs[c]), q, r2);
+  }
+  const uint32x4_t sign =
+      vshlq_n_u32(vreinterpretq_u32_s32(vcvtnq_s32_f32(k)), 31);
+  const float32x4_t sinPi = vreinterpretq_f32_u32(
+      veorq_u32(vreinterpretq_u32_f32(vmulq_f32(r, q)), sign));
+  const float32x4_t sinc = vdivq_f32(sinPi, vmulq_n_f32(x, kPi));
+  const uint32x4_t tiny = vcltq_f32(vabsq_f32(x), vdupq_n_f32(1e-5f));
+  return vbslq_f32(tiny, vdupq_n_f32(1.f), sinc);
+}
+
+inline void displaceNeon(const DisplacementInput &in, size_t begin,
+                         size_t end, const DisplacementTerms &terms,
+                         const DisplacementOutput &out) {
+  const size_t numSpkrs = terms.weight.size();
+  const float32x4_t one = vdupq_n_f32(1.f), minusOne = vdupq_n_f32(-1.f);
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    const float32x4_t dx = vld1q_f32(in.dirX + i);
+    const float32x4_t dy = vld1q_f32(in.dirY + i);
+    const float32x4_t dz = vld1q_f32(in.dirZ + i);
+    float32x4_t sum = vdupq_n_f32(0.f);
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      float32x4_t d = vmulq_n_f32(dx, terms.posX[s]);
+      d = vfmaq_n_f32(d, dy, terms.posY[s]);
+      d = vfmaq_n_f32(d, dz, terms.posZ[s]);
+      d = vminq_f32(vmaxq_f32(d, minusOne), one);
+      const float32x4_t sinc =
+          sincNeon(vmulq_n_f32(acosNeon(d), terms.frequency[s]));
+      sum = vfmaq_n_f32(sum, sinc, terms.weight[s]);
+    }
+    sum = vmulq_n_f32(sum, terms.scale);
+    const float32x4_t r = vaddq_f32(vld1q_f32(in.radius + i), sum);
+    vst1q_f32(out.x + i, vmulq_f32(dx, r));
+    vst1q_f32(out.y + i, vmulq_f32(dy, r));
+    vst1q_f32(out.z + i, vmulq_f32(dz, r));
+    vst1q_f32(out.displacement + i, sum);
+  }
+  displaceScalar(in, i, end, terms, out);
+}
+#endif
+
+using DisplaceFn = void (*)(const DisplacementInput &, size_t, size_t,
+                            const DisplacementTerms &,
+                            const DisplacementOutput &);
+
+struct DisplaceKernel {
+  const char *name;
+  DisplaceFn fn;
+};
+
+// Picks the widest kernel the running CPU supports. Resolved once.
+inline const DisplaceKernel &displaceKernel() {
+  static const DisplaceKernel kernel = []() -> DisplaceKernel {
+#ifdef DISPLACEMENT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return {"avx512", displaceAvx512};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return {"avx2", displaceAvx2};
+    }
+#elif defined(DISPLACEMENT_NEON)
+    return {"neon", displaceNeon};
+#endif
+    return {"scalar", displaceScalar};
+  }();
+  return kernel;
+}
+
+// Displaces a point set on the CPU, split across a WorkerPool. Input is kept
+// as structure-of-arrays so every kernel streams unit-stride.
+class DisplacementEngine {
+public:
+  // Points of work handed to a thread at a time; a multiple of every vector
+  // width.
+  static constexpr size_t kChunkPoints = 4096;
+
+  DisplacementEngine(const std::vector<glm::vec3> &points,
+                     const std::vector<glm::vec3> &spkrPos,
+                     unsigned numThreads = 0)
+      : dirX(points.size()), dirY(points.size()), dirZ(points.size()),
+        radius(points.size()), pool(numThreads) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      const float r = glm::length(points[i]);
+      const glm::vec3 dir = points[i] / r;
+      dirX[i] = dir.x;
+      dirY[i] = dir.y;
+      dirZ[i] = dir.z;
+      radius[i] = r;
+    }
+    setSpeakers(spkrPos);
+  }
+
+  DisplacementEngine(const DisplacementEngine &) = delete;
+  DisplacementEngine &operator=(const DisplacementEngine &) = delete;
+
+  size_t size() const { return radius.size(); }
+  unsigned getNumThreads() const { return pool.getNumThreads(); }
+
+  void setSpeakers(const std::vector<glm::vec3> &spkrPos) {
+    terms.posX.clear();
+    terms.posY.clear();
+    terms.posZ.clear();
+    for (const glm::vec3 &p : spkrPos) {
+      const glm::vec3 dir = glm::normalize(p);
+      terms.posX.push_back(dir.x);
+      terms.posY.push_back(dir.y);
+      terms.posZ.push_back(dir.z);
+    }
+    terms.weight.assign(spkrPos.size(), 0.f);
+    terms.frequency.assign(spkrPos.size(), 0.f);
+  }
+
+  // Writes size() displaced points as four float arrays packed back to back
+  // (x..., y..., z..., displacement...), e.g. straight into a mapped vertex
+  // buffer. spkrLevels holds one entry per speaker, as in room.vs. `kernel`
+  // defaults to the fastest one available.
+  void displace(const FrameUniforms &frame,
+                const std::vector<glm::vec4> &spkrLevels, float *out,
+                DisplaceFn kernel = nullptr) {
+    displace(frame, spkrLevels, out, 0, size(), kernel);
+  }
+
+  // Same, but only points [first, last) are computed and written; the
+  // output keeps the size()-long stream layout, e.g. for drawing one level
+  // of a LOD chain stored in a single buffer.
+  void displace(const FrameUniforms &frame,
+                const std::vector<glm::vec4> &spkrLevels, float *out,
+                size_t first, size_t last, DisplaceFn kernel = nullptr) {
+    const size_t n = size();
+    last = std::min(last, n);
+    updateTerms(frame, spkrLevels);
+    const DisplacementInput in{dirX.data(), dirY.data(), dirZ.data(),
+                               radius.data()};
+    const DisplacementOutput dst{out, out + n, out + 2 * n, out + 3 * n};
+    if (kernel == nullptr) {
+      kernel = displaceKernel().fn;
+    }
+    const size_t count = last > first ? last - first : 0;
+    const size_t numChunks = (count + kChunkPoints - 1) / kChunkPoints;
+    pool.parallelFor(numChunks, [&](size_t chunk) {
+      const size_t begin = first + chunk * kChunkPoints;
+      kernel(in, begin, std::min(last, begin + kChunkPoints), terms, dst);
+    });
+  }
+
+private:
+  // Same amplitude and frequency selection as the speaker loop in room.vs.
+  void updateTerms(const FrameUniforms &frame,
+                   const std::vector<glm::vec4> &spkrLevels) {
+    const size_t numSpkrs = std::min(terms.weight.size(), spkrLevels.size());
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      const glm::vec4 &levels = spkrLevels[s];
+      float amplitude = levels.x;
+      float rippleDrive = amplitude;
+      if (frame.useBands != 0) {
+        amplitude = levels.y + 0.5f * levels.z;
+        rippleDrive = levels.w;
+      }
+      terms.weight[s] = 3.f * amplitude;
+      terms.frequency[s] = frame.baseSpatialFrequency +
+                           frame.amplitudeFrequencyScale * rippleDrive;
+    }
+    terms.scale = frame.maxOverallDisplacement;
+  }
+
+  std::vector<float> dirX, dirY, dirZ, radius;
+  DisplacementTerms terms;
+  WorkerPool pool;
+};
+
+#endif
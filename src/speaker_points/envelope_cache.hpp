@@ -0,0 +1,245 @@
+#ifndef ENVELOPE_CACHE_H
+#define ENVELOPE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Sidecar file holding a precomputed loudness envelope for one audio file.
+//
+// Layout (native endianness):
+//   EnvelopeHeader
+//   numEpochs records of (1 + numChannels * (1 + numBands)) floats:
+//   timestamp, one dB value per channel, then in band mode numBands values
+//   per channel, channel-major.
+//
+// The file is mapped read-only and records are served straight from the
+// mapping, so opening it costs a stat() and an mmap() no matter how long the
+// track is.
+
+// Everything the envelope values depend on besides the audio itself. Bump
+// analysisVersion whenever the per-epoch math changes.
+struct EnvelopeParams {
+  float epochLength_s;
+  uint32_t samplesPerEpoch;
+  uint32_t analysisVersion;
+  // Band levels per channel, and hashBuffer() of the crossover frequencies;
+  // both 0 for broadband-only records.
+  uint32_t numBands;
+  uint64_t bandSplitsHash;
+
+  size_t recordStride(int numChannels) const {
+    return 1 + static_cast<size_t>(numChannels) * (1 + numBands);
+  }
+};
+
+struct EnvelopeHeader {
+  char magic[8];
+  uint32_t headerSize;
+  uint32_t numChannels;
+  uint64_t numEpochs;
+  // Content key. Size and mtime let an unchanged file skip rehashing.
+  uint64_t contentHash;
+  uint64_t fileSize;
+  int64_t fileMtime;
+  EnvelopeParams params;
+  float sampleRate;
+  float length_s;
+};
+
+// 64-bit FNV-1a, eight bytes at a time; `hash` continues an earlier call.
+inline uint64_t hashBuffer(const void *data, size_t size,
+                           uint64_t hash = 0xcbf29ce484222325ull) {
+  const uint64_t kPrime = 0x100000001b3ull;
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * kPrime;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash;
+}
+
+// hashBuffer() over the file, a megabyte at a time.
+inline uint64_t hashFileContents(const std::string &path) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  std::vector<uint8_t> buf(1 << 20);
+  ssize_t got;
+  while ((got = ::read(fd, buf.data(), buf.size())) > 0) {
+    hash = hashBuffer(buf.data(), got, hash);
+  }
+  ::close(fd);
+  return hash;
+}
+
+// Writes `path` via write(FILE *) into a temporary file of its own, then
+// renames it into place. The temporary name is unique to this process and
+// call, so concurrent writers (headless shards, a second instance, loader
+// threads) never share one; the rename is the only shared step, and a reader
+// sees either the old file or a complete new one. Returns false, leaving no
+// temporary behind, if anything fails.
+template <typename Write>
+inline bool replaceFile(const std::string &path, Write &&write) {
+  static std::atomic<unsigned> nextId{0};
+  const std::string tmpPath = path + ".tmp." + std::to_string(::getpid()) +
+                              "." + std::to_string(nextId++);
+  const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0) {
+    return false;
+  }
+  FILE *f = ::fdopen(fd, "wb");
+  if (f == nullptr) {
+    ::close(fd);
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  bool ok = write(f);
+  ok = (std::fclose(f) == 0) && ok;
+  if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+class EnvelopeCache {
+public:
+  static constexpr char kMagic[8] = {'S', 'A', 'E', 'N', 'V', '0', '0', '2'};
+
+  static std::string sidecarPath(const std::string &audioPath) {
+    return audioPath + ".env";
+  }
+
+  EnvelopeCache() = default;
+  ~EnvelopeCache() { close(); }
+  EnvelopeCache(const EnvelopeCache &) = delete;
+  EnvelopeCache &operator=(const EnvelopeCache &) = delete;
+
+  // Maps the sidecar for audioPath if it exists and was produced from the
+  // same audio contents with the same params. Returns false (and stays closed)
+  // otherwise.
+  bool open(const std::string &audioPath, const EnvelopeParams &params) {
+    close();
+    struct stat audioStat;
+    if (::stat(audioPath.c_str(), &audioStat) != 0) {
+      return false;
+    }
+    int fd = ::open(sidecarPath(audioPath).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(EnvelopeHeader)) {
+      ::close(fd);
+      return false;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+    mapping = addr;
+    mappingSize = st.st_size;
+
+    const EnvelopeHeader &h = header();
+    const size_t expectedSize =
+        sizeof(EnvelopeHeader) +
+        h.numEpochs * h.params.recordStride(h.numChannels) * sizeof(float);
+    bool valid = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 &&
+                 h.headerSize == sizeof(EnvelopeHeader) &&
+                 mappingSize == expectedSize &&
+                 h.params.epochLength_s == params.epochLength_s &&
+                 h.params.samplesPerEpoch == params.samplesPerEpoch &&
+                 h.params.analysisVersion == params.analysisVersion &&
+                 h.params.numBands == params.numBands &&
+                 h.params.bandSplitsHash == params.bandSplitsHash &&
+                 h.fileSize == static_cast<uint64_t>(audioStat.st_size);
+    // A touched but unchanged file still hits; only then is it rehashed.
+    if (valid && h.fileMtime != static_cast<int64_t>(audioStat.st_mtime)) {
+      valid = h.contentHash == hashFileContents(audioPath);
+    }
+    if (!valid) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (mapping != nullptr) {
+      ::munmap(mapping, mappingSize);
+      mapping = nullptr;
+      mappingSize = 0;
+    }
+  }
+
+  bool isOpen() const { return mapping != nullptr; }
+  const EnvelopeHeader &header() const {
+    return *static_cast<const EnvelopeHeader *>(mapping);
+  }
+  size_t getNumEpochs() const { return header().numEpochs; }
+  int getNumChannels() const { return header().numChannels; }
+  int getNumBands() const { return header().params.numBands; }
+  size_t getRecordStride() const {
+    return header().params.recordStride(header().numChannels);
+  }
+
+  // Record i: timestamp, getNumChannels() dB values, then the band levels.
+  const float *record(size_t i) const {
+    const float *records = reinterpret_cast<const float *>(
+        static_cast<const char *>(mapping) + sizeof(EnvelopeHeader));
+    return records + i * getRecordStride();
+  }
+
+  // Writes a sidecar for audioPath. `records` holds numEpochs records laid out
+  // as described above. It goes through replaceFile(), so a reader never maps
+  // a half-written envelope. Failure (e.g. a read-only media directory) is not
+  // an error; the next run just analyses again.
+  static bool write(const std::string &audioPath, const EnvelopeParams &params,
+                    int numChannels, float sampleRate, float length_s,
+                    const std::vector<float> &records) {
+    struct stat audioStat;
+    if (::stat(audioPath.c_str(), &audioStat) != 0) {
+      return false;
+    }
+    EnvelopeHeader h = {};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.headerSize = sizeof(EnvelopeHeader);
+    h.numChannels = numChannels;
+    h.numEpochs = records.size() / params.recordStride(numChannels);
+    h.contentHash = hashFileContents(audioPath);
+    h.fileSize = audioStat.st_size;
+    h.fileMtime = audioStat.st_mtime;
+    h.params = params;
+    h.sampleRate = sampleRate;
+    h.length_s = length_s;
+
+    return replaceFile(sidecarPath(audioPath), [&](FILE *f) {
+      return std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+             std::fwrite(records.data(), sizeof(float), records.size(), f) ==
+                 records.size();
+    });
+  }
+
+private:
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef EPOCH_PRODUCER_H
+#define EPOCH_PRODUCER_H
+
+#include "speaker_dbs.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Runs a LoudnessGenerator on its own thread and hands epochs to the render
+// thread through an SpscRing. The producer stays up to one ring's worth of
+// epochs ahead, so decode and file I/O stalls are absorbed by the ring instead
+// of landing on frame time.
+class EpochProducer {
+public:
+  EpochProducer(LoudnessGenerator &generator, size_t capacity = 64)
+      : generator(generator),
+        ring(capacity, emptySlot(generator)),
+        kIdleSleep(std::chrono::duration<float>(
+            std::max(generator.getEpochLength_s(), 1e-3f) / 2)) {
+    worker = std::thread([this] { run(); });
+  }
+
+  ~EpochProducer() {
+    running = false;
+    worker.join();
+  }
+
+  EpochProducer(const EpochProducer &) = delete;
+  EpochProducer &operator=(const EpochProducer &) = delete;
+
+  // Render thread. Hands every queued epoch starting before `horizon_s` to
+  // consume(epoch), oldest first, so the renderer can interpolate towards
+  // upcoming epochs. Epochs that had already ended at `time` count as
+  // overruns. Returns the number consumed.
+  template <typename Consume>
+  size_t popAhead(float time, float horizon_s, Consume &&consume) {
+    consumerTime.store(time, std::memory_order_relaxed);
+    const float period_s = generator.getEpochPeriod_s();
+    size_t popped = 0;
+    const LoudnessEpoch *next;
+    while ((next = ring.front()) != nullptr && next->timeStamp < horizon_s) {
+      if (next->timeStamp + period_s < time) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+      }
+      consume(*next);
+      deliveredEnd_s = next->timeStamp + period_s;
+      ++popped;
+      ring.pop();
+    }
+    // Running dry only matters if the epoch covering `time` hasn't been
+    // handed out yet, by this call or an earlier one.
+    if (next == nullptr && deliveredEnd_s <= time &&
+        !finished.load(std::memory_order_acquire)) {
+      underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    return popped;
+  }
+
+  // True once the generator has run out and the ring has drained.
+  bool isFinished() const {
+    return finished.load(std::memory_order_acquire) && ring.front() == nullptr;
+  }
+
+  // Frames that found the ring empty before the epoch covering their time had
+  // been delivered, short of the end of the track.
+  uint64_t getUnderruns() const { return underruns.load(); }
+  // Epochs that had ended before the render thread consumed them, i.e. it
+  // fell more than one epoch behind.
+  uint64_t getOverruns() const { return overruns.load(); }
+
+private:
+  // Slots are sized for the generator's output up front so filling them never
+  // allocates.
+  static LoudnessEpoch emptySlot(const LoudnessGenerator &generator) {
+    const int numChannels = generator.getNumChannels();
+    const bool lufs = generator.getMode() == LoudnessMode::kLufs;
+    return {-1, std::vector<float>(numChannels),
+            std::vector<float>(numChannels * generator.getNumBands()),
+            std::vector<float>(lufs ? numChannels : 0),
+            std::vector<float>(lufs ? numChannels : 0)};
+  }
+
+  void run() {
+    const float kCatchUp_s = 2 * generator.getEpochLength_s();
+    while (running) {
+      const float now = consumerTime.load(std::memory_order_relaxed);
+      if (now - generator.getPosition_s() > kCatchUp_s) {
+        // The render thread is already past what we would produce next; jump
+        // to its time rather than analysing epochs it would only drop.
+        generator.seek(now);
+      }
+
+      LoudnessEpoch *slot = ring.beginPush();
+      if (slot == nullptr || finished.load(std::memory_order_relaxed)) {
+        // Far enough ahead (or done); wait for the render thread.
+        std::this_thread::sleep_for(kIdleSleep);
+        continue;
+      }
+      LoudnessEpoch epoch = generator.nextLoudnessEpoch();
+      if (epoch.timeStamp < 0) {
+        finished.store(true, std::memory_order_release);
+        continue;
+      }
+      slot->timeStamp = epoch.timeStamp;
+      slot->speakerDbs.assign(epoch.speakerDbs.begin(), epoch.speakerDbs.end());
+      slot->bandDbs.assign(epoch.bandDbs.begin(), epoch.bandDbs.end());
+      slot->momentaryLufs.assign(epoch.momentaryLufs.begin(),
+                                 epoch.momentaryLufs.end());
+      slot->shortTermLufs.assign(epoch.shortTermLufs.begin(),
+                                 epoch.shortTermLufs.end());
+      ring.commitPush();
+    }
+  }
+
+  LoudnessGenerator &generator;
+  SpscRing<LoudnessEpoch> ring;
+  const std::chrono::duration<float> kIdleSleep;
+  std::atomic<bool> running{true};
+  std::atomic<bool> finished{false};
+  std::atomic<float> consumerTime{0.f};
+  float deliveredEnd_s = 0.f; // End of the newest epoch popAhead() handed out.
+  std::atomic<uint64_t> underruns{0};
+  std::atomic<uint64_t> overruns{0};
+  std::thread worker;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef LUFS_METER_H
+#define LUFS_METER_H
+
+#include "k_weighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Streaming ITU-R BS.1770 / EBU R 128 loudness of a multichannel track, fed
+// one epoch at a time. After each epoch it reports every channel's momentary
+// (400 ms) and short-term (3 s) loudness over the window ending with that
+// epoch, and keeps the 400 ms gating blocks (75 % overlap) the track's gated
+// integrated loudness comes from.
+//
+// Windows are whole epochs: K-weighted energy is kept per epoch, and a window
+// is the most recent round(length / epoch) of them (390 ms and 3 s for the
+// room's 30 ms epochs), as is the 100 ms gating step. Until a window has
+// filled it covers what has been fed so far.
+class LufsMeter {
+public:
+  // Quietest value reported, in place of the -inf of digital silence.
+  static constexpr float kFloor_lufs = -120.f;
+
+  LufsMeter(int numChannels, float sampleRate, size_t samplesPerEpoch)
+      : numChannels(numChannels),
+        kNumLanes((numChannels + kKWeightLanes - 1) / kKWeightLanes *
+                  kKWeightLanes),
+        kCoeffs(KWeightCoeffs::forSampleRate(sampleRate)),
+        kMomentaryEpochs(epochsFor(0.4, sampleRate, samplesPerEpoch)),
+        kShortTermEpochs(epochsFor(3.0, sampleRate, samplesPerEpoch)),
+        kGateStepEpochs(epochsFor(0.1, sampleRate, samplesPerEpoch)),
+        weights(numChannels, 1.f), state(4 * kNumLanes),
+        epochEnergy(kShortTermEpochs * kNumLanes),
+        epochCounts(kShortTermEpochs), epochSums(kNumLanes),
+        momentary(numChannels, kFloor_lufs),
+        shortTerm(numChannels, kFloor_lufs) {
+    reset();
+  }
+
+  // Channels in the interleaved frames addEpoch() takes: numChannels rounded
+  // up to whole SIMD groups.
+  size_t getFrameStride() const { return kNumLanes; }
+
+  // BS.1770 channel weights for the integrated value (1.41 for surrounds, 0
+  // to leave out an LFE; see SpeakerLayout::getLoudnessWeights()). All 1 by
+  // default. Set them before the first epoch; the per-channel values don't
+  // use them.
+  void setChannelWeights(const std::vector<float> &channelWeights) {
+    for (int ch = 0; ch < numChannels; ++ch) {
+      weights[ch] = ch < int(channelWeights.size()) ? channelWeights[ch] : 1.f;
+    }
+  }
+
+  // Clears filter state, windows and gating blocks, as at the start of a
+  // track.
+  void reset() {
+    std::fill(state.begin(), state.end(), 0.0);
+    std::fill(epochEnergy.begin(), epochEnergy.end(), 0.0);
+    std::fill(epochCounts.begin(), epochCounts.end(), 0);
+    std::fill(momentary.begin(), momentary.end(), kFloor_lufs);
+    std::fill(shortTerm.begin(), shortTerm.end(), kFloor_lufs);
+    numEpochs = 0;
+    blockEnergies.clear();
+  }
+
+  // Filters `count` frames, getFrameStride() floats apart (padding channels
+  // zero), and updates the momentary and short-term values.
+  void addEpoch(const float *frames, size_t count) {
+    std::fill(epochSums.begin(), epochSums.end(), 0.0);
+    kWeightKernel().fn(frames, count, kNumLanes, kNumLanes, kCoeffs,
+                       state.data(), epochSums.data());
+    // Long silences decay the delays into denormals, which are slow on most
+    // CPUs; anything this small is silence anyway.
+    for (double &z : state) {
+      if (std::abs(z) < 1e-30) {
+        z = 0.0;
+      }
+    }
+    const size_t slot = numEpochs % kShortTermEpochs;
+    std::copy(epochSums.begin(), epochSums.end(),
+              epochEnergy.begin() + slot * kNumLanes);
+    epochCounts[slot] = count;
+    ++numEpochs;
+
+    windowLoudness(kMomentaryEpochs, momentary, &momentaryEnergy);
+    windowLoudness(kShortTermEpochs, shortTerm, nullptr);
+    if (numEpochs >= kMomentaryEpochs &&
+        (numEpochs - kMomentaryEpochs) % kGateStepEpochs == 0) {
+      blockEnergies.push_back(momentaryEnergy);
+    }
+  }
+
+  // Per channel, over the window ending with the last epoch.
+  const std::vector<float> &getMomentary() const { return momentary; }
+  const std::vector<float> &getShortTerm() const { return shortTerm; }
+
+  // Gated loudness of everything fed since the last reset(): blocks under
+  // -70 LUFS are dropped, then blocks more than 10 LU below the mean of the
+  // rest.
+  float getIntegrated() const {
+    double sum = 0.0;
+    size_t n = 0;
+    for (double energy : blockEnergies) {
+      if (toLufs(energy) > -70.f) {
+        sum += energy;
+        ++n;
+      }
+    }
+    if (n == 0) {
+      return kFloor_lufs;
+    }
+    const float relativeGate = toLufs(sum / n) - 10.f;
+    sum = 0.0;
+    n = 0;
+    for (double energy : blockEnergies) {
+      const float lufs = toLufs(energy);
+      if (lufs > -70.f && lufs > relativeGate) {
+        sum += energy;
+        ++n;
+      }
+    }
+    return n == 0 ? kFloor_lufs : toLufs(sum / n);
+  }
+
+  static float toLufs(double meanSquare) {
+    if (!(meanSquare > 0.0)) {
+      return kFloor_lufs;
+    }
+    return std::max(kFloor_lufs,
+                    static_cast<float>(-0.691 + 10.0 * std::log10(meanSquare)));
+  }
+
+private:
+  static size_t epochsFor(double seconds, float sampleRate,
+                          size_t samplesPerEpoch) {
+    return std::max<size_t>(
+        1, static_cast<size_t>(std::lround(
+               seconds * sampleRate / std::max<size_t>(samplesPerEpoch, 1))));
+  }
+
+  // Loudness of each channel over the last `window` epochs into `out`; the
+  // channel-weighted sum of their mean squares into `weighted` if given.
+  void windowLoudness(size_t window, std::vector<float> &out,
+                      double *weighted) {
+    window = std::min(window, numEpochs);
+    std::fill(epochSums.begin(), epochSums.end(), 0.0);
+    size_t count = 0;
+    for (size_t e = numEpochs - window; e < numEpochs; ++e) {
+      const size_t slot = e % kShortTermEpochs;
+      const double *energy = epochEnergy.data() + slot * kNumLanes;
+      for (int ch = 0; ch < numChannels; ++ch) {
+        epochSums[ch] += energy[ch];
+      }
+      count += epochCounts[slot];
+    }
+    double total = 0.0;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      const double meanSquare = count > 0 ? epochSums[ch] / count : 0.0;
+      out[ch] = toLufs(meanSquare);
+      total += weights[ch] * meanSquare;
+    }
+    if (weighted != nullptr) {
+      *weighted = total;
+    }
+  }
+
+  const int numChannels;
+  const int kNumLanes;
+  const KWeightCoeffs kCoeffs;
+  const size_t kMomentaryEpochs;
+  const size_t kShortTermEpochs;
+  const size_t kGateStepEpochs;
+  std::vector<float> weights;
+  std::vector<double> state;
+  // K-weighted energy per channel of the last kShortTermEpochs epochs, and
+  // their lengths in samples; epoch e in slot e % kShortTermEpochs.
+  std::vector<double> epochEnergy;
+  std::vector<size_t> epochCounts;
+  std::vector<double> epochSums;
+  size_t numEpochs = 0;
+  std::vector<float> momentary;
+  std::vector<float> shortTerm;
+  double momentaryEnergy = 0.0;
+  // Channel-weighted mean square of each gating block so far.
+  std::vector<double> blockEnergies;
+};
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef PCM_SUM_SQUARES_H
+#define PCM_SUM_SQUARES_H
+
+#include "sum_squares.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Per-channel sums of squares taken straight from interleaved integer PCM, so
+// broadband analysis never decodes to float. Squares are summed as integers,
+// which is exact: each kernel adds its frames' squares, in native units, to
+// sums[0, numChannels). The caller scales once per epoch and keeps each call
+// short enough not to overflow (WavReader::readSumSquares).
+//
+// The vector kernels keep one accumulator lane per sample position within a
+// vector, so they need a packed layout (stride = numChannels * sample bytes)
+// and a channel count that divides the vector's sample count; anything else
+// goes through the scalar kernel.
+//
+// An int32 square leaves an int64 room for just two, so the int32 kernels
+// convert to double (exactly), square and accumulate there instead, like
+// sum_squares.hpp does for floats.
+
+using PcmSumSquaresFn = void (*)(const uint8_t *frames, size_t numFrames,
+                                 int numChannels, size_t stride,
+                                 int64_t *sums);
+
+struct PcmSumSquaresKernel {
+  const char *name;
+  PcmSumSquaresFn fn;
+};
+
+using PcmSumSquaresInt32Fn = void (*)(const uint8_t *frames, size_t numFrames,
+                                      int numChannels, size_t stride,
+                                      double *sums);
+
+struct PcmSumSquaresInt32Kernel {
+  const char *name;
+  PcmSumSquaresInt32Fn fn;
+};
+
+inline int32_t pcmInt24(const uint8_t *p) {
+  // Assemble in the top of an int32 so the shift back sign-extends.
+  return static_cast<int32_t>((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) |
+                              (uint32_t(p[2]) << 24)) >>
+         8;
+}
+
+inline void pcmSumSquaresInt16Scalar(const uint8_t *frames, size_t numFrames,
+                                     int numChannels, size_t stride,
+                                     int64_t *sums) {
+  for (size_t i = 0; i < numFrames; ++i) {
+    const uint8_t *frame = frames + i * stride;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      const int32_t s = static_cast<int16_t>(frame[2 * ch] |
+                                             (frame[2 * ch + 1] << 8));
+      sums[ch] += s * s;
+    }
+  }
+}
+
+inline void pcmSumSquaresInt24Scalar(const uint8_t *frames, size_t numFrames,
+                                     int numChannels, size_t stride,
+                                     int64_t *sums) {
+  for (size_t i = 0; i < numFrames; ++i) {
+    const uint8_t *frame = frames + i * stride;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      const int64_t s = pcmInt24(frame + 3 * ch);
+      sums[ch] += s * s;
+    }
+  }
+}
+
+inline void pcmSumSquaresInt32Scalar(const uint8_t *frames, size_t numFrames,
+                                     int numChannels, size_t stride,
+                                     double *sums) {
+  for (size_t i = 0; i < numFrames; ++i) {
+    const uint8_t *frame = frames + i * stride;
+    for (int ch = 0; ch < numChannels; ++ch) {
+      int32_t s;
+      std::memcpy(&s, frame + 4 * ch, sizeof(s));
+      const double d = s;
+      sums[ch] += d * d;
+    }
+  }
+}
+
+// Adds lane totals, one per sample position, to their channels.
+template <typename T>
+inline void pcmAddLanes(const T *lanes, int numLanes, int numChannels,
+                        T *sums) {
+  for (int pos = 0; pos < numLanes; ++pos) {
+    sums[pos % numChannels] += lanes[pos];
+  }
+}
+
+#ifdef SUM_SQUARES_X86
+// pmaddwd of a vector with its own even (odd) samples masked off yields the
+// odd (even) samples' squares as int32, which widen into int64 accumulators.
+__attribute__((target("sse2"))) inline void
+pcmSumSquaresInt16Sse2(const uint8_t *frames, size_t numFrames,
+                       int numChannels, size_t stride, int64_t *sums) {
+  if (stride != 2 * size_t(numChannels) || 8 % numChannels != 0) {
+    pcmSumSquaresInt16Scalar(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  const __m128i evenMask = _mm_set1_epi32(0x0000FFFF);
+  const __m128i oddMask = _mm_set1_epi32(int32_t(0xFFFF0000));
+  const __m128i zero = _mm_setzero_si128();
+  // Positions 0, 2 | 4, 6 | 1, 3 | 5, 7.
+  __m128i even0 = zero, even1 = zero, odd0 = zero, odd1 = zero;
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 2 * i));
+    const __m128i even = _mm_madd_epi16(v, _mm_and_si128(v, evenMask));
+    const __m128i odd = _mm_madd_epi16(v, _mm_and_si128(v, oddMask));
+    even0 = _mm_add_epi64(even0, _mm_unpacklo_epi32(even, zero));
+    even1 = _mm_add_epi64(even1, _mm_unpackhi_epi32(even, zero));
+    odd0 = _mm_add_epi64(odd0, _mm_unpacklo_epi32(odd, zero));
+    odd1 = _mm_add_epi64(odd1, _mm_unpackhi_epi32(odd, zero));
+  }
+  int64_t e[4], o[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(e), even0);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(e + 2), even1);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(o), odd0);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(o + 2), odd1);
+  const int64_t lanes[8] = {e[0], o[0], e[1], o[1], e[2], o[2], e[3], o[3]};
+  pcmAddLanes(lanes, 8, numChannels, sums);
+  pcmSumSquaresInt16Scalar(frames + 2 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+
+__attribute__((target("avx2"))) inline void
+pcmSumSquaresInt16Avx2(const uint8_t *frames, size_t numFrames,
+                       int numChannels, size_t stride, int64_t *sums) {
+  if (stride != 2 * size_t(numChannels) || 16 % numChannels != 0) {
+    pcmSumSquaresInt16Sse2(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  const __m256i evenMask = _mm256_set1_epi32(0x0000FFFF);
+  const __m256i oddMask = _mm256_set1_epi32(int32_t(0xFFFF0000));
+  // Positions 0, 2, 4, 6 | 8, 10, 12, 14 | 1, 3, 5, 7 | 9, 11, 13, 15.
+  __m256i even0 = _mm256_setzero_si256(), even1 = even0;
+  __m256i odd0 = even0, odd1 = even0;
+  size_t i = 0;
+  for (; i + 16 <= numSamples; i += 16) {
+    const __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(frames + 2 * i));
+    const __m256i even = _mm256_madd_epi16(v, _mm256_and_si256(v, evenMask));
+    const __m256i odd = _mm256_madd_epi16(v, _mm256_and_si256(v, oddMask));
+    even0 = _mm256_add_epi64(
+        even0, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(even)));
+    even1 = _mm256_add_epi64(
+        even1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(even, 1)));
+    odd0 = _mm256_add_epi64(odd0,
+                            _mm256_cvtepu32_epi64(_mm256_castsi256_si128(odd)));
+    odd1 = _mm256_add_epi64(
+        odd1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(odd, 1)));
+  }
+  int64_t e[8], o[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(e), even0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(e + 4), even1);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(o), odd0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + 4), odd1);
+  int64_t lanes[16];
+  for (int k = 0; k < 8; ++k) {
+    lanes[2 * k] = e[k];
+    lanes[2 * k + 1] = o[k];
+  }
+  pcmAddLanes(lanes, 16, numChannels, sums);
+  pcmSumSquaresInt16Scalar(frames + 2 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+
+// pshufb moves each packed 3-byte sample into the top of a 32-bit lane, an
+// arithmetic shift sign-extends it, and pmuldq squares lanes 0, 2 (then 1, 3)
+// into int64.
+__attribute__((target("sse4.1"))) inline void
+pcmSumSquaresInt24Sse41(const uint8_t *frames, size_t numFrames,
+                        int numChannels, size_t stride, int64_t *sums) {
+  if (stride != 3 * size_t(numChannels) || 4 % numChannels != 0) {
+    pcmSumSquaresInt24Scalar(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  const __m128i unpack =
+      _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  // Positions 0, 2 | 1, 3.
+  __m128i even = _mm_setzero_si128(), odd = even;
+  size_t i = 0;
+  // Each load reads 16 bytes for 12 bytes of samples; stop before it would
+  // run past the end.
+  for (; 3 * i + 16 <= 3 * numSamples; i += 4) {
+    const __m128i raw =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 3 * i));
+    const __m128i s = _mm_srai_epi32(_mm_shuffle_epi8(raw, unpack), 8);
+    even = _mm_add_epi64(even, _mm_mul_epi32(s, s));
+    const __m128i high = _mm_srli_epi64(s, 32);
+    odd = _mm_add_epi64(odd, _mm_mul_epi32(high, high));
+  }
+  int64_t e[2], o[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(e), even);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(o), odd);
+  const int64_t lanes[4] = {e[0], o[0], e[1], o[1]};
+  pcmAddLanes(lanes, 4, numChannels, sums);
+  pcmSumSquaresInt24Scalar(frames + 3 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+
+// cvtdq2pd widens each half of a vector of int32 samples to double.
+__attribute__((target("sse2"))) inline void
+pcmSumSquaresInt32Sse2(const uint8_t *frames, size_t numFrames,
+                       int numChannels, size_t stride, double *sums) {
+  if (stride != 4 * size_t(numChannels) || 4 % numChannels != 0) {
+    pcmSumSquaresInt32Scalar(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  // Positions 0, 1 | 2, 3.
+  __m128d lo = _mm_setzero_pd(), hi = lo;
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 4 * i));
+    const __m128d a = _mm_cvtepi32_pd(v);
+    const __m128d b = _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v));
+    lo = _mm_add_pd(lo, _mm_mul_pd(a, a));
+    hi = _mm_add_pd(hi, _mm_mul_pd(b, b));
+  }
+  double lanes[4];
+  _mm_storeu_pd(lanes, lo);
+  _mm_storeu_pd(lanes + 2, hi);
+  pcmAddLanes(lanes, 4, numChannels, sums);
+  pcmSumSquaresInt32Scalar(frames + 4 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+
+__attribute__((target("avx2,fma"))) inline void
+pcmSumSquaresInt32Avx2(const uint8_t *frames, size_t numFrames,
+                       int numChannels, size_t stride, double *sums) {
+  if (stride != 4 * size_t(numChannels) || 8 % numChannels != 0) {
+    pcmSumSquaresInt32Sse2(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  // Positions 0-3 | 4-7.
+  __m256d lo = _mm256_setzero_pd(), hi = lo;
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8) {
+    const __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(frames + 4 * i));
+    const __m256d a = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+    const __m256d b = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+    lo = _mm256_fmadd_pd(a, a, lo);
+    hi = _mm256_fmadd_pd(b, b, hi);
+  }
+  double lanes[8];
+  _mm256_storeu_pd(lanes, lo);
+  _mm256_storeu_pd(lanes + 4, hi);
+  pcmAddLanes(lanes, 8, numChannels, sums);
+  pcmSumSquaresInt32Scalar(frames + 4 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+#endif
+
+#ifdef SUM_SQUARES_NEON
+inline void pcmSumSquaresInt16Neon(const uint8_t *frames, size_t numFrames,
+                                   int numChannels, size_t stride,
+                                   int64_t *sums) {
+  if (stride != 2 * size_t(numChannels) || 8 % numChannels != 0) {
+    pcmSumSquaresInt16Scalar(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  // Positions 0, 1 | 2, 3 | 4, 5 | 6, 7.
+  int64x2_t acc0 = vdupq_n_s64(0), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8) {
+    int16_t block[8];
+    std::memcpy(block, frames + 2 * i, sizeof(block));
+    const int16x8_t v = vld1q_s16(block);
+    const int32x4_t lo = vmull_s16(vget_low_s16(v), vget_low_s16(v));
+    const int32x4_t hi = vmull_high_s16(v, v);
+    acc0 = vaddw_s32(acc0, vget_low_s32(lo));
+    acc1 = vaddw_high_s32(acc1, lo);
+    acc2 = vaddw_s32(acc2, vget_low_s32(hi));
+    acc3 = vaddw_high_s32(acc3, hi);
+  }
+  int64_t lanes[8];
+  vst1q_s64(lanes, acc0);
+  vst1q_s64(lanes + 2, acc1);
+  vst1q_s64(lanes + 4, acc2);
+  vst1q_s64(lanes + 6, acc3);
+  pcmAddLanes(lanes, 8, numChannels, sums);
+  pcmSumSquaresInt16Scalar(frames + 2 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+
+inline void pcmSumSquaresInt32Neon(const uint8_t *frames, size_t numFrames,
+                                   int numChannels, size_t stride,
+                                   double *sums) {
+  if (stride != 4 * size_t(numChannels) || 4 % numChannels != 0) {
+    pcmSumSquaresInt32Scalar(frames, numFrames, numChannels, stride, sums);
+    return;
+  }
+  const size_t numSamples = numFrames * numChannels;
+  // Positions 0, 1 | 2, 3.
+  float64x2_t lo = vdupq_n_f64(0.0), hi = lo;
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4) {
+    int32_t block[4];
+    std::memcpy(block, frames + 4 * i, sizeof(block));
+    const int32x4_t v = vld1q_s32(block);
+    const float64x2_t a = vcvtq_f64_s64(vmovl_s32(vget_low_s32(v)));
+    const float64x2_t b = vcvtq_f64_s64(vmovl_high_s32(v));
+    lo = vfmaq_f64(lo, a, a);
+    hi = vfmaq_f64(hi, b, b);
+  }
+  double lanes[4];
+  vst1q_f64(lanes, lo);
+  vst1q_f64(lanes + 2, hi);
+  pcmAddLanes(lanes, 4, numChannels, sums);
+  pcmSumSquaresInt32Scalar(frames + 4 * i, (numSamples - i) / numChannels,
+                           numChannels, stride, sums);
+}
+#endif
+
+// The widest int16 / int24 / int32 kernels the running CPU supports. Resolved
+// once.
+inline const PcmSumSquaresKernel &pcmInt16Kernel() {
+  static const PcmSumSquaresKernel kernel = []() -> PcmSumSquaresKernel {
+#ifdef SUM_SQUARES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return {"avx2", pcmSumSquaresInt16Avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      return {"sse2", pcmSumSquaresInt16Sse2};
+    }
+#elif defined(SUM_SQUARES_NEON)
+    return {"neon", pcmSumSquaresInt16Neon};
+#endif
+    return {"scalar", pcmSumSquaresInt16Scalar};
+  }();
+  return kernel;
+}
+
+inline const PcmSumSquaresKernel &pcmInt24Kernel() {
+  static const PcmSumSquaresKernel kernel = []() -> PcmSumSquaresKernel {
+#ifdef SUM_SQUARES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+      return {"sse4.1", pcmSumSquaresInt24Sse41};
+    }
+#endif
+    return {"scalar", pcmSumSquaresInt24Scalar};
+  }();
+  return kernel;
+}
+
+inline const PcmSumSquaresInt32Kernel &pcmInt32Kernel() {
+  static const PcmSumSquaresInt32Kernel kernel =
+      []() -> PcmSumSquaresInt32Kernel {
+#ifdef SUM_SQUARES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return {"avx2", pcmSumSquaresInt32Avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      return {"sse2", pcmSumSquaresInt32Sse2};
+    }
+#elif defined(SUM_SQUARES_NEON)
+    return {"neon", pcmSumSquaresInt32Neon};
+#endif
+    return {"scalar", pcmSumSquaresInt32Scalar};
+  }();
+  return kernel;
+}
+
+#endif
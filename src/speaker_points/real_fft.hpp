@@ -0,0 +1,107 @@
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Power spectrum of a real signal of power-of-two length N. The input is
+// packed into an N/2-point complex FFT and split back into the N/2 + 1
+// one-sided bins. Twiddles and the bit-reversal table are computed once, and
+// all scratch lives in the object, so powerSpectrum() never allocates. Data is
+// kept as separate real/imaginary arrays and each stage's twiddles are
+// contiguous, so the butterfly loops are unit-stride and vectorize.
+class RealFft {
+public:
+  explicit RealFft(size_t size) : kSize(size), kHalf(size / 2) {
+    const double kTwoPi = 2.0 * M_PI;
+    bitReverse.resize(kHalf);
+    size_t bits = 0;
+    while ((size_t(1) << bits) < kHalf) {
+      ++bits;
+    }
+    for (size_t i = 0; i < kHalf; ++i) {
+      size_t r = 0;
+      for (size_t b = 0; b < bits; ++b) {
+        r |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      bitReverse[i] = r;
+    }
+    // Stage with butterfly span `len` uses twiddles len/2 - 1 .. len - 2.
+    for (size_t len = 2; len <= kHalf; len <<= 1) {
+      for (size_t j = 0; j < len / 2; ++j) {
+        stageTwRe.push_back(static_cast<float>(std::cos(-kTwoPi * j / len)));
+        stageTwIm.push_back(static_cast<float>(std::sin(-kTwoPi * j / len)));
+      }
+    }
+    splitTwRe.resize(kHalf + 1);
+    splitTwIm.resize(kHalf + 1);
+    for (size_t k = 0; k <= kHalf; ++k) {
+      splitTwRe[k] = static_cast<float>(std::cos(-kTwoPi * k / kSize));
+      splitTwIm[k] = static_cast<float>(std::sin(-kTwoPi * k / kSize));
+    }
+    re.resize(kHalf);
+    im.resize(kHalf);
+  }
+
+  size_t size() const { return kSize; }
+  size_t numBins() const { return kHalf + 1; }
+
+  // Writes |X[k]|^2 for k = 0..N/2 into power (numBins() floats). `input`
+  // holds N samples.
+  void powerSpectrum(const float *input, float *power) {
+    for (size_t i = 0; i < kHalf; ++i) {
+      const size_t r = bitReverse[i];
+      re[r] = input[2 * i];
+      im[r] = input[2 * i + 1];
+    }
+    transform();
+
+    // X[k] = (Z[k] + conj(Z[M-k])) / 2 - i W^k (Z[k] - conj(Z[M-k])) / 2
+    for (size_t k = 0; k <= kHalf; ++k) {
+      const size_t a = k == kHalf ? 0 : k;
+      const size_t b = k == 0 ? 0 : kHalf - k;
+      const float evenRe = 0.5f * (re[a] + re[b]);
+      const float evenIm = 0.5f * (im[a] - im[b]);
+      const float oddRe = 0.5f * (im[a] + im[b]);
+      const float oddIm = -0.5f * (re[a] - re[b]);
+      const float xRe = evenRe + splitTwRe[k] * oddRe - splitTwIm[k] * oddIm;
+      const float xIm = evenIm + splitTwRe[k] * oddIm + splitTwIm[k] * oddRe;
+      power[k] = xRe * xRe + xIm * xIm;
+    }
+  }
+
+private:
+  // In-place radix-2 decimation-in-time FFT of (re, im), already in
+  // bit-reversed order.
+  void transform() {
+    size_t twOffset = 0;
+    for (size_t len = 2; len <= kHalf; len <<= 1) {
+      const size_t half = len / 2;
+      const float *twRe = stageTwRe.data() + twOffset;
+      const float *twIm = stageTwIm.data() + twOffset;
+      for (size_t start = 0; start < kHalf; start += len) {
+        float *aRe = re.data() + start, *aIm = im.data() + start;
+        float *bRe = aRe + half, *bIm = aIm + half;
+        for (size_t j = 0; j < half; ++j) {
+          const float tRe = bRe[j] * twRe[j] - bIm[j] * twIm[j];
+          const float tIm = bRe[j] * twIm[j] + bIm[j] * twRe[j];
+          bRe[j] = aRe[j] - tRe;
+          bIm[j] = aIm[j] - tIm;
+          aRe[j] += tRe;
+          aIm[j] += tIm;
+        }
+      }
+      twOffset += half;
+    }
+  }
+
+  const size_t kSize;
+  const size_t kHalf;
+  std::vector<size_t> bitReverse;
+  std::vector<float> stageTwRe, stageTwIm;
+  std::vector<float> splitTwRe, splitTwIm;
+  std::vector<float> re, im;
+};
+
+#endif
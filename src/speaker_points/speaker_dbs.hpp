@@ -1,23 +1,80 @@
-#include <AudioFile.h>
+#ifndef SPEAKER_DBS_H
+#define SPEAKER_DBS_H
+
+#include "band_energy.hpp"
+#include "envelope_cache.hpp"
+#include "lufs_meter.hpp"
+#include "wav_reader.hpp"
 #include <algorithm> // For std::min
-#include <cmath>     // For std::sqrt
-#include <iostream>  // For debugging output
-#include <numeric>   // Potentially for std::accumulate, but direct loop is fine
+#include <atomic>
+#include <cmath>    // For std::sqrt
+#include <iostream> // For debugging output
+#include <limits>
+#include <memory>
+#include <numeric> // Potentially for std::accumulate, but direct loop is fine
+#include <thread>
 #include <vector>
 
 struct LoudnessEpoch {
   float timeStamp;
+  // |dB| of each channel's mean square; in LUFS mode the momentary loudness
+  // negated (LU below 0 LUFS), positive like the RMS values but without
+  // folding over near full scale.
   std::vector<float> speakerDbs;
+  // Band mode only: getNumBands() values per channel, channel-major.
+  std::vector<float> bandDbs;
+  // LUFS mode only: per channel, over the 400 ms / 3 s ending with this
+  // epoch.
+  std::vector<float> momentaryLufs;
+  std::vector<float> shortTermLufs;
+};
+
+enum class LoudnessMode { kRms, kLufs };
+
+// A run of consecutive epochs stored contiguously. Each record is the
+// timestamp, one dB value per channel, then in band mode numBands values per
+// channel: the same layout as the envelope sidecar.
+struct LoudnessEnvelope {
+  int numChannels = 0;
+  int numBands = 0;
+  std::vector<float> records;
+
+  size_t getRecordStride() const {
+    return 1 + static_cast<size_t>(numChannels) * (1 + numBands);
+  }
+  size_t size() const { return records.size() / getRecordStride(); }
+  LoudnessEpoch operator[](size_t i) const {
+    const float *rec = records.data() + i * getRecordStride();
+    const float *bands = rec + 1 + numChannels;
+    return {rec[0], std::vector<float>(rec + 1, bands),
+            std::vector<float>(bands, rec + getRecordStride())};
+  }
 };
 
 class LoudnessGenerator {
 public:
-  LoudnessGenerator(const std::string inPath, const float epochLength_s)
-      : kInputPath(inPath), kEpochLength_s(epochLength_s) {
+  // Identifies the per-epoch math in envelope sidecars. Bump it whenever
+  // nextLoudnessEpoch() would produce different values for the same input.
+  // 2: integer PCM is summed exactly in integers (readSumSquares()).
+  // 3: band levels are stored alongside the broadband ones.
+  // 4: int32 PCM is squared in double rather than decoded to float first.
+  static constexpr uint32_t kAnalysisVersion = 4;
+
+  // Passing bandSplits_hz (crossover frequencies, ascending) turns on band
+  // mode: every epoch also carries per-channel band levels in bandDbs, and
+  // the envelope sidecar stores them too. LoudnessMode::kLufs meters the
+  // K-weighted signal (LufsMeter) instead of the raw mean square; the meter
+  // carries state from epoch to epoch, so that mode always decodes and has
+  // no sidecar.
+  LoudnessGenerator(const std::string inPath, const float epochLength_s,
+                    const std::vector<float> &bandSplits_hz = {},
+                    LoudnessMode mode = LoudnessMode::kRms)
+      : kInputPath(inPath), kEpochLength_s(epochLength_s),
+        kBandSplits_hz(bandSplits_hz), inFile(kInputPath) {
 
-    // Load input audio file here and record its sample rate and stuff.
-    // TODO: Add error handling for inFile.load()
-    inFile.load(kInputPath);
+    // Only the header is read here; samples are streamed in per epoch. A file
+    // that fails to open reports zero samples, so the first epoch is the
+    // end-of-track marker.
     sampleRate = inFile.getSampleRate();
     length_s = inFile.getLengthInSeconds();
     // BUG FIX: samplesPerEpoch calculation was incorrect (division instead of
@@ -30,54 +87,351 @@ public:
       samplesPerEpoch =
           1; // Ensure at least one sample per epoch if duration is positive
     }
+
+    if (mode == LoudnessMode::kLufs && samplesPerEpoch > 0) {
+      lufsMeter = std::make_unique<LufsMeter>(inFile.getNumChannels(),
+                                              sampleRate, samplesPerEpoch);
+    }
+    if (!bandSplits_hz.empty() && samplesPerEpoch > 0) {
+      bandAnalyzer = std::make_unique<BandAnalyzer>(sampleRate, samplesPerEpoch,
+                                                    bandSplits_hz);
+    }
+    if (lufsMeter) {
+      return;
+    }
+
+    // Serve epochs from a previous run's envelope when one matches this file,
+    // otherwise record what we compute so the next run can.
+    if (!envelopeCache.open(kInputPath, envelopeParams()) &&
+        samplesPerEpoch > 0) {
+      const size_t numEpochs =
+          (inFile.getNumSamplesPerChannel() + samplesPerEpoch - 1) /
+          samplesPerEpoch;
+      envelope.reserve(numEpochs *
+                       envelopeParams().recordStride(inFile.getNumChannels()));
+      recordingEnvelope = true;
+    }
   }
 
   float getLength_s() const { return length_s; }
+  float getEpochLength_s() const { return kEpochLength_s; }
+  // Spacing of consecutive epochs' timestamps: the epoch length rounded to
+  // whole samples.
+  float getEpochPeriod_s() const {
+    return sampleRate > 0 ? static_cast<float>(samplesPerEpoch) / sampleRate
+                          : kEpochLength_s;
+  }
+  int getNumChannels() const { return inFile.getNumChannels(); }
+  int getNumBands() const {
+    return bandAnalyzer ? static_cast<int>(bandAnalyzer->getNumBands()) : 0;
+  }
+  LoudnessMode getMode() const {
+    return lufsMeter ? LoudnessMode::kLufs : LoudnessMode::kRms;
+  }
+
+  // LUFS mode: BS.1770 channel weights for getIntegratedLufs().
+  void setChannelWeights(const std::vector<float> &weights) {
+    if (lufsMeter) {
+      lufsMeter->setChannelWeights(weights);
+    }
+  }
+  // LUFS mode: gated integrated loudness of the epochs produced so far (the
+  // whole track once the last one is out). After a seek it restarts from up
+  // to 3 s before the new position.
+  float getIntegratedLufs() const {
+    return lufsMeter ? lufsMeter->getIntegrated() : LufsMeter::kFloor_lufs;
+  }
+  // Start time of the epoch the next nextLoudnessEpoch() call returns.
+  float getPosition_s() const { return epochTimeStamp(sampleIdx); }
 
   LoudnessEpoch nextLoudnessEpoch() {
+    LoudnessEpoch epoch = epochStartingAt(sampleIdx);
+    if (epoch.timeStamp < 0) {
+      return epoch;
+    }
+    sampleIdx += samplesPerEpoch;
+
+    if (recordingEnvelope) {
+      envelope.push_back(epoch.timeStamp);
+      envelope.insert(envelope.end(), epoch.speakerDbs.begin(),
+                      epoch.speakerDbs.end());
+      envelope.insert(envelope.end(), epoch.bandDbs.begin(),
+                      epoch.bandDbs.end());
+      if (sampleIdx >= inFile.getNumSamplesPerChannel()) {
+        EnvelopeCache::write(kInputPath, envelopeParams(),
+                             inFile.getNumChannels(), sampleRate, length_s,
+                             envelope);
+        stopRecordingEnvelope();
+      }
+    }
+    return epoch;
+  };
+
+  // The epoch containing time t_s, without moving the nextLoudnessEpoch()
+  // cursor. Costs one epoch of decode (or a lookup in the sidecar) wherever t_s
+  // is in the track. Returns the end-of-track marker {-1, {}} past the end.
+  LoudnessEpoch epochAt(float t_s) {
+    return epochStartingAt(epochIndexAt(t_s) * samplesPerEpoch);
+  }
+
+  // Moves the cursor so the next nextLoudnessEpoch() returns the epoch
+  // containing t_s. Jumping breaks the contiguous run the sidecar is built
+  // from, so a run that seeks doesn't write one.
+  void seek(float t_s) {
+    const size_t target = epochIndexAt(t_s) * samplesPerEpoch;
+    if (target != sampleIdx) {
+      stopRecordingEnvelope();
+    }
+    sampleIdx = target;
+  }
+
+  // dB of one channel over one epoch from its sum of squares. Shared by the
+  // sequential and batch paths (and LoudnessPyramid) so all produce
+  // identical bits.
+  static float epochDb(double sum_sq, size_t count) {
+    float db = static_cast<float>(
+        10 * std::log10(sum_sq / static_cast<double>(count)));
+    return std::abs(db);
+  }
+
+  // Analyses every epoch overlapping [t0_s, t1_s) into one contiguous
+  // envelope, band levels included in band mode. Epochs fall on the same
+  // sample grid as nextLoudnessEpoch() and go through the same math
+  // (analyzeEpoch()), so the values are bit-identical to the sequential
+  // path. Work is split into blocks of epochs across threads. Does not move
+  // the nextLoudnessEpoch() cursor. Analysing the whole track also writes the
+  // envelope sidecar if there isn't one yet. Always RMS, whatever the mode.
+  LoudnessEnvelope
+  analyzeRange(float t0_s = 0.f,
+               float t1_s = std::numeric_limits<float>::infinity(),
+               unsigned numThreads = 0) {
+    LoudnessEnvelope out;
+    out.numChannels = inFile.getNumChannels();
+    out.numBands = getNumBands();
     const size_t kTotalSamples = inFile.getNumSamplesPerChannel();
+    if (samplesPerEpoch == 0 || kTotalSamples == 0) {
+      return out;
+    }
+    const size_t kTotalEpochs =
+        (kTotalSamples + samplesPerEpoch - 1) / samplesPerEpoch;
+    const size_t firstEpoch = std::min(epochIndexAt(t0_s), kTotalEpochs);
+    const size_t endEpoch =
+        t1_s >= length_s ? kTotalEpochs
+                         : std::min(epochIndexAt(t1_s) + 1, kTotalEpochs);
+    if (firstEpoch >= endEpoch) {
+      return out;
+    }
+    const size_t numEpochs = endEpoch - firstEpoch;
+    const size_t stride = out.getRecordStride();
+    out.records.resize(numEpochs * stride);
+
+    if (envelopeCache.isOpen()) {
+      std::copy(envelopeCache.record(firstEpoch),
+                envelopeCache.record(firstEpoch) + numEpochs * stride,
+                out.records.begin());
+      return out;
+    }
+
+    if (numThreads == 0) {
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const int numChannels = out.numChannels;
+    const size_t kBlockEpochs = 64;
+    const size_t numBlocks = (numEpochs + kBlockEpochs - 1) / kBlockEpochs;
+    numThreads = std::min<size_t>(numThreads, numBlocks);
 
-    if (sampleIdx >= kTotalSamples) {
+    std::atomic<size_t> nextBlock{0};
+    auto worker = [&]() {
+      // Each worker streams through its own reader so they don't contend on
+      // one look-ahead window.
+      WavReader reader(kInputPath, kBlockEpochs * samplesPerEpoch);
+      std::unique_ptr<BandAnalyzer> bands;
+      if (bandAnalyzer) {
+        bands = std::make_unique<BandAnalyzer>(sampleRate, samplesPerEpoch,
+                                               kBandSplits_hz);
+      }
+      std::vector<double> sums;
+      std::vector<std::vector<float>> samples;
+      for (size_t block = nextBlock++; block < numBlocks;
+           block = nextBlock++) {
+        const size_t blockEnd =
+            std::min(numEpochs, (block + 1) * kBlockEpochs);
+        for (size_t e = block * kBlockEpochs; e < blockEnd; ++e) {
+          const size_t start = (firstEpoch + e) * samplesPerEpoch;
+          const size_t count =
+              std::min(samplesPerEpoch, kTotalSamples - start);
+          float *rec = out.records.data() + e * stride;
+          rec[0] = epochTimeStamp(start);
+          analyzeEpoch(reader, bands.get(), start, count, sums, samples,
+                       rec + 1, rec + 1 + numChannels);
+        }
+      }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < numThreads; ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+      t.join();
+    }
+
+    if (numEpochs == kTotalEpochs) {
+      EnvelopeCache::write(kInputPath, envelopeParams(), numChannels,
+                           sampleRate, length_s, out.records);
+    }
+    return out;
+  }
+
+private:
+  // Broadband levels of the epoch [start, start + count) into
+  // dbs[0, numChannels) and, if `bands` is given, its band levels into
+  // bandDbs, channel-major. `sums` and `samples` are scratch.
+  static void analyzeEpoch(WavReader &reader, BandAnalyzer *bands,
+                           size_t start, size_t count,
+                           std::vector<double> &sums,
+                           std::vector<std::vector<float>> &samples,
+                           float *dbs, float *bandDbs) {
+    const int numChannels = reader.getNumChannels();
+    sums.resize(numChannels);
+    reader.readSumSquares(start, count, sums.data());
+    for (int ch = 0; ch < numChannels; ++ch) {
+      dbs[ch] = epochDb(sums[ch], count);
+    }
+    if (bands) {
+      // Only the band filters need decoded samples.
+      reader.readPlanar(start, count, samples);
+      const size_t numBands = bands->getNumBands();
+      for (int ch = 0; ch < numChannels; ++ch) {
+        bands->analyze(samples[ch].data(), count, bandDbs + ch * numBands);
+      }
+    }
+  }
+
+  float epochTimeStamp(size_t startSample) const {
+    return static_cast<float>(startSample) / sampleRate;
+  }
+
+  size_t epochIndexAt(float t_s) const {
+    if (!(t_s > 0.f) || samplesPerEpoch == 0) {
+      return 0;
+    }
+    return static_cast<size_t>(static_cast<double>(t_s) * sampleRate) /
+           samplesPerEpoch;
+  }
+
+  EnvelopeParams envelopeParams() const {
+    return {kEpochLength_s, static_cast<uint32_t>(samplesPerEpoch),
+            kAnalysisVersion, static_cast<uint32_t>(getNumBands()),
+            kBandSplits_hz.empty()
+                ? 0
+                : hashBuffer(kBandSplits_hz.data(),
+                             kBandSplits_hz.size() * sizeof(float))};
+  }
+
+  // Computes, or reads from the sidecar, the epoch beginning at startSample.
+  LoudnessEpoch epochStartingAt(size_t startSample) {
+    if (envelopeCache.isOpen()) {
+      const size_t epochIdx =
+          startSample / std::max<size_t>(samplesPerEpoch, 1);
+      if (epochIdx >= envelopeCache.getNumEpochs()) {
+        return {-1, {}};
+      }
+      const float *rec = envelopeCache.record(epochIdx);
+      const float *bands = rec + 1 + envelopeCache.getNumChannels();
+      return {rec[0], std::vector<float>(rec + 1, bands),
+              std::vector<float>(bands, rec + envelopeCache.getRecordStride())};
+    }
+
+    const size_t kTotalSamples = inFile.getNumSamplesPerChannel();
+
+    if (startSample >= kTotalSamples) {
       return {-1, {}};
     }
 
     // Calculate the actual number of samples to read in this epoch
     size_t samplesToRead = samplesPerEpoch;
-    if (sampleIdx + samplesToRead > kTotalSamples) {
-      samplesToRead = kTotalSamples - sampleIdx;
+    if (startSample + samplesToRead > kTotalSamples) {
+      samplesToRead = kTotalSamples - startSample;
     }
 
     std::vector<float> ldness(inFile.getNumChannels());
-    for (int ch = 0; ch < inFile.getNumChannels(); ++ch) {
-      float sum_sq = 0;
-      for (size_t sample_offset = 0; sample_offset < samplesToRead;
-           ++sample_offset) {
-        size_t current_sample_idx = sampleIdx + sample_offset;
-        sum_sq += inFile.samples[ch][current_sample_idx] *
-                  inFile.samples[ch][current_sample_idx];
+    std::vector<float> momentaryLufs, shortTermLufs;
+    if (lufsMeter) {
+      meterUpTo(startSample);
+      meterEpoch(startSample, samplesToRead);
+      momentaryLufs = lufsMeter->getMomentary();
+      shortTermLufs = lufsMeter->getShortTerm();
+      for (int ch = 0; ch < inFile.getNumChannels(); ++ch) {
+        ldness[ch] = -momentaryLufs[ch];
       }
-      float db = 10 * std::log10(sum_sq / static_cast<float>(samplesToRead));
-      ldness[ch] = std::abs(db);
     }
 
-    const float timeStamp = static_cast<float>(sampleIdx) / sampleRate;
+    std::vector<float> bandDbs(inFile.getNumChannels() * getNumBands());
+    if (!lufsMeter) {
+      analyzeEpoch(inFile, bandAnalyzer.get(), startSample, samplesToRead,
+                   epochSums, epochSamples, ldness.data(), bandDbs.data());
+    }
 
-    sampleIdx += samplesToRead;
+    // std::cout << "Processed epoch starting at sample: " << startSample
+    //           << ", samples read: " << samplesToRead << "\n";
 
-    // std::cout << "Processed epoch starting at sample: "
-    //           << sampleIdx - samplesToRead
-    //           << ", samples read: " << samplesToRead
-    //           << ", timestamp: " << timeStamp << "\n";
+    return {epochTimeStamp(startSample), ldness, bandDbs, momentaryLufs,
+            shortTermLufs};
+  }
 
-    return {timeStamp, ldness};
-  };
+  // The meter's filters and windows need every sample before startSample.
+  // A short forward gap (a skipped stretch, another shard's frames) is
+  // metered through; anything else restarts from up to 3 s earlier, which
+  // fills the short-term window and lets the filters settle.
+  void meterUpTo(size_t startSample) {
+    const size_t preRoll =
+        static_cast<size_t>(std::ceil(3.0 * sampleRate / samplesPerEpoch)) *
+        samplesPerEpoch;
+    if (startSample < meterNext || startSample - meterNext > preRoll) {
+      lufsMeter->reset();
+      meterNext = startSample - std::min(startSample, preRoll);
+    }
+    while (meterNext < startSample) {
+      meterEpoch(meterNext, std::min(samplesPerEpoch,
+                                     inFile.getNumSamplesPerChannel() -
+                                         meterNext));
+    }
+  }
+
+  void meterEpoch(size_t startSample, size_t count) {
+    inFile.readInterleaved(startSample, count, epochFrames,
+                           lufsMeter->getFrameStride());
+    lufsMeter->addEpoch(epochFrames.data(), count);
+    meterNext = startSample + count;
+  }
+
+  void stopRecordingEnvelope() {
+    recordingEnvelope = false;
+    envelope = {};
+  }
 
-private:
   const std::string kInputPath;
   const float kEpochLength_s;
+  const std::vector<float> kBandSplits_hz;
   float sampleRate;
   float length_s;
   size_t samplesPerEpoch;
   size_t sampleIdx = 0;
-  AudioFile<float> inFile;
-};
\ No newline at end of file
+  WavReader inFile;
+  // Per-channel sums of squares, and in band mode decoded samples, for the
+  // epoch being analysed; reused between calls.
+  std::vector<double> epochSums;
+  std::vector<std::vector<float>> epochSamples;
+  std::unique_ptr<BandAnalyzer> bandAnalyzer;
+  // LUFS mode: the meter, the next sample it expects, and decoded frames.
+  std::unique_ptr<LufsMeter> lufsMeter;
+  size_t meterNext = 0;
+  std::vector<float> epochFrames;
+  EnvelopeCache envelopeCache;
+  // Records computed so far, written out as a sidecar at end of track.
+  std::vector<float> envelope;
+  bool recordingEnvelope = false;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef SPEAKER_LAYOUT_H
+#define SPEAKER_LAYOUT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where each channel of a track is played from. Speakers are listed in channel
+// order, so speaker i is driven by channel i.
+//
+// Directions are azimuth / elevation in degrees as in ITU-R BS.2051: azimuth
+// counterclockwise seen from above (positive is to the listener's left),
+// elevation up from the horizon. The listener faces the camera, so front is
+// +z and up is +y.
+struct SpeakerLayout {
+  struct Speaker {
+    std::string label;
+    float azimuth_deg;
+    float elevation_deg;
+  };
+
+  std::string name;
+  std::vector<Speaker> speakers;
+
+  size_t size() const { return speakers.size(); }
+
+  // Unit direction of every speaker, in channel order.
+  std::vector<glm::vec3> getPositions() const {
+    std::vector<glm::vec3> positions;
+    positions.reserve(speakers.size());
+    for (const Speaker &s : speakers) {
+      positions.push_back(
+          azimuthElevationToCartesian(s.azimuth_deg, s.elevation_deg));
+    }
+    return positions;
+  }
+
+  // ITU-R BS.1770 channel weight of every speaker, in channel order, for
+  // gated integrated loudness: 0 for an LFE (any label starting "LFE"),
+  // 1.41 (+1.5 dB) for one beside or behind the listener (60 to 120 degrees
+  // of azimuth, under 30 of elevation), 1 otherwise.
+  std::vector<float> getLoudnessWeights() const {
+    std::vector<float> weights;
+    weights.reserve(speakers.size());
+    for (const Speaker &s : speakers) {
+      const float azimuth = std::abs(s.azimuth_deg);
+      if (s.label.rfind("LFE", 0) == 0) {
+        weights.push_back(0.f);
+      } else if (azimuth >= 60.f && azimuth <= 120.f &&
+                 std::abs(s.elevation_deg) < 30.f) {
+        weights.push_back(1.41f);
+      } else {
+        weights.push_back(1.f);
+      }
+    }
+    return weights;
+  }
+
+  static glm::vec3 azimuthElevationToCartesian(float azimuth_deg,
+                                               float elevation_deg) {
+    const float az = glm::radians(azimuth_deg);
+    const float el = glm::radians(elevation_deg);
+    return glm::vec3(-std::sin(az) * std::cos(el), std::sin(el),
+                     std::cos(az) * std::cos(el));
+  }
+
+  // Named presets in WAV / SMPTE channel order. LFE channels carry no
+  // direction; they sit low in front so they still show up on the sphere.
+  static const std::vector<SpeakerLayout> &presets() {
+    static const std::vector<SpeakerLayout> kPresets = {
+        {"mono", {{"C", 0, 0}}},
+        {"stereo", {{"L", 30, 0}, {"R", -30, 0}}},
+        {"3.0", {{"L", 30, 0}, {"R", -30, 0}, {"C", 0, 0}}},
+        {"quad", {{"L", 45, 0}, {"R", -45, 0}, {"Ls", 135, 0},
+                  {"Rs", -135, 0}}},
+        {"5.1",
+         {{"L", 30, 0}, {"R", -30, 0}, {"C", 0, 0}, {"LFE", 0, -30},
+          {"Ls", 110, 0}, {"Rs", -110, 0}}},
+        {"7.1",
+         {{"L", 30, 0}, {"R", -30, 0}, {"C", 0, 0}, {"LFE", 0, -30},
+          {"Lrs", 150, 0}, {"Rrs", -150, 0}, {"Lss", 90, 0},
+          {"Rss", -90, 0}}},
+        {"7.1.4",
+         {{"L", 30, 0}, {"R", -30, 0}, {"C", 0, 0}, {"LFE", 0, -30},
+          {"Lrs", 150, 0}, {"Rrs", -150, 0}, {"Lss", 90, 0},
+          {"Rss", -90, 0}, {"Ltf", 45, 45}, {"Rtf", -45, 45},
+          {"Ltr", 135, 45}, {"Rtr", -135, 45}}},
+        // SMPTE ST 2036-2 order.
+        {"22.2",
+         {{"FL", 60, 0},     {"FR", -60, 0},     {"FC", 0, 0},
+          {"LFE1", 45, -30}, {"BL", 135, 0},     {"BR", -135, 0},
+          {"FLc", 30, 0},    {"FRc", -30, 0},    {"BC", 180, 0},
+          {"LFE2", -45, -30}, {"SiL", 90, 0},    {"SiR", -90, 0},
+          {"TpFL", 45, 30},  {"TpFR", -45, 30},  {"TpFC", 0, 30},
+          {"TpC", 0, 90},    {"TpBL", 135, 30},  {"TpBR", -135, 30},
+          {"TpSiL", 90, 30}, {"TpSiR", -90, 30}, {"TpBC", 180, 30},
+          {"BtFC", 0, -30},  {"BtFL", 45, -30},  {"BtFR", -45, -30}}},
+    };
+    return kPresets;
+  }
+
+  static const SpeakerLayout *findPreset(const std::string &name) {
+    for (const SpeakerLayout &preset : presets()) {
+      if (preset.name == name) {
+        return &preset;
+      }
+    }
+    return nullptr;
+  }
+
+  // The first preset with numChannels speakers, or failing that numChannels
+  // speakers spaced evenly around the horizon, starting front left.
+  static SpeakerLayout forChannels(int numChannels) {
+    for (const SpeakerLayout &preset : presets()) {
+      if (preset.size() == static_cast<size_t>(numChannels)) {
+        return preset;
+      }
+    }
+    SpeakerLayout ring{std::to_string(numChannels) + "-speaker ring", {}};
+    for (int i = 0; i < numChannels; ++i) {
+      ring.speakers.push_back({std::to_string(i + 1),
+                               30.f - 360.f * i / numChannels, 0.f});
+    }
+    return ring;
+  }
+
+  // Reads a layout description: one speaker per line in channel order, as
+  // "<label> <azimuth_deg> <elevation_deg>". Blank lines and text after '#'
+  // are ignored.
+  static bool load(const std::string &path, SpeakerLayout &layout) {
+    std::ifstream file(path);
+    if (!file) {
+      std::cout << "ERROR::LAYOUT::FILE_NOT_SUCCESSFULLY_READ: " << path
+                << std::endl;
+      return false;
+    }
+    SpeakerLayout loaded{path, {}};
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+      std::istringstream fields(line.substr(0, line.find('#')));
+      Speaker speaker;
+      if (!(fields >> speaker.label)) {
+        continue;
+      }
+      if (!(fields >> speaker.azimuth_deg >> speaker.elevation_deg)) {
+        std::cout << "ERROR::LAYOUT::PARSE: " << path << ":" << lineNumber
+                  << " expects <label> <azimuth> <elevation>" << std::endl;
+        return false;
+      }
+      loaded.speakers.push_back(speaker);
+    }
+    if (loaded.speakers.empty()) {
+      std::cout << "ERROR::LAYOUT::EMPTY: " << path << std::endl;
+      return false;
+    }
+    layout = std::move(loaded);
+    return true;
+  }
+
+  // Resolves --layout for a track with numChannels channels. `spec` is a
+  // preset name, a layout file, or empty to pick by channel count. A layout
+  // that doesn't fit the track is reported and replaced by forChannels().
+  static SpeakerLayout resolve(const std::string &spec, int numChannels) {
+    numChannels = std::max(numChannels, 1);
+    if (spec.empty()) {
+      return forChannels(numChannels);
+    }
+    SpeakerLayout layout;
+    if (const SpeakerLayout *preset = findPreset(spec)) {
+      layout = *preset;
+    } else if (!load(spec, layout)) {
+      return forChannels(numChannels);
+    }
+    if (layout.size() != static_cast<size_t>(numChannels)) {
+      const SpeakerLayout fallback = forChannels(numChannels);
+      std::cout << "ERROR::LAYOUT::CHANNEL_MISMATCH: " << layout.name
+                << " has " << layout.size() << " speakers but the audio has "
+                << numChannels << " channels; using " << fallback.name
+                << std::endl;
+      return fallback;
+    }
+    return layout;
+  }
+};
+
+#endif
@@ -1,10 +1,14 @@
+#ifndef SPEAKER_POINTS_H
+#define SPEAKER_POINTS_H
+
 #include <glm/glm.hpp>
-#include <vector>
 
-inline std::vector<glm::vec3> generateFibonacciSpherePoints(int numPoints) {
-  std::vector<glm::vec3> points;
-  points.reserve(numPoints);
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
+// Writes numPoints points into `points`, which must have room for them.
+inline void generateFibonacciSpherePoints(int numPoints, glm::vec3 *points) {
   const float phi = M_PI * (3.0 - std::sqrt(5.0)); // Golden angle in radians
 
   for (int i = 0; i < numPoints; ++i) {
@@ -15,12 +19,84 @@ inline std::vector<glm::vec3> generateFibonacciSpherePoints(int numPoints) {
     float x = radius * std::cos(theta);
     float z = radius * std::sin(theta);
 
-    points.push_back(glm::vec3(x, y, z));
+    points[i] = glm::vec3(x, y, z);
   }
+}
 
+inline std::vector<glm::vec3> generateFibonacciSpherePoints(int numPoints) {
+  std::vector<glm::vec3> points(std::max(numPoints, 0));
+  generateFibonacciSpherePoints(numPoints, points.data());
   return points;
 }
 
+// Fibonacci spheres of increasing density packed into one array, for drawing
+// a level of detail as a single range of a shared vertex buffer.
+struct FibonacciSphereLods {
+  std::vector<glm::vec3> points;
+  // Level l is points [offsets[l], offsets[l] + counts[l]), coarsest first.
+  std::vector<size_t> offsets;
+  std::vector<size_t> counts;
+
+  size_t getNumLevels() const { return counts.size(); }
+
+  // Drops the densest levels until at most maxPoints remain in total. The
+  // coarsest level is always kept.
+  void truncate(size_t maxPoints) {
+    while (counts.size() > 1 && points.size() > maxPoints) {
+      points.resize(offsets.back());
+      offsets.pop_back();
+      counts.pop_back();
+    }
+  }
+};
+
+// Levels of minPoints, minPoints * factor, ... up to and including maxPoints.
+inline FibonacciSphereLods generateFibonacciSphereLods(int minPoints,
+                                                       int maxPoints,
+                                                       int factor = 4) {
+  FibonacciSphereLods lods;
+  minPoints = std::max(minPoints, 2);
+  maxPoints = std::max(maxPoints, minPoints);
+  factor = std::max(factor, 2);
+  size_t total = 0;
+  for (long n = minPoints;; n *= factor) {
+    const int count = static_cast<int>(std::min<long>(n, maxPoints));
+    lods.offsets.push_back(total);
+    lods.counts.push_back(count);
+    total += count;
+    if (count == maxPoints) {
+      break;
+    }
+  }
+  // Every level is generated in place in the one array.
+  lods.points.resize(total);
+  for (size_t l = 0; l < lods.getNumLevels(); ++l) {
+    generateFibonacciSpherePoints(static_cast<int>(lods.counts[l]),
+                                  lods.points.data() + lods.offsets[l]);
+  }
+  return lods;
+}
+
+// Geodesic distance (the angle in radians on the unit sphere) from every point
+// to every speaker, point-major with `stride` slots per point; slots past the
+// last speaker are left at 0. Computed in double, since it is only redone when
+// the speaker layout changes.
+inline std::vector<float> speakerAngles(const std::vector<glm::vec3> &points,
+                                        const std::vector<glm::vec3> &spkrPos,
+                                        size_t stride) {
+  std::vector<float> angles(points.size() * stride, 0.f);
+  const size_t numSpkrs = std::min(spkrPos.size(), stride);
+  for (size_t i = 0; i < points.size(); ++i) {
+    const glm::dvec3 p = glm::normalize(glm::dvec3(points[i]));
+    for (size_t s = 0; s < numSpkrs; ++s) {
+      const double d = glm::dot(p, glm::normalize(glm::dvec3(spkrPos[s])));
+      angles[i * stride + s] =
+          static_cast<float>(std::acos(std::clamp(d, -1.0, 1.0)));
+    }
+  }
+  return angles;
+}
+
 inline glm::vec3 sphericalToCartesian(float r, float theta, float phi) {
   // Radius in the XZ plane
   float xz_radius = r * std::sin(theta);
@@ -33,3 +109,5 @@ inline glm::vec3 sphericalToCartesian(float r, float theta, float phi) {
 
   return glm::vec3(x, y, z);
 }
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring. Slots are allocated once up
+// front and reused; the producer fills a slot in place and publishes it, the
+// consumer reads it in place and releases it. Every operation is wait-free.
+template <typename T> class SpscRing {
+public:
+  // Capacity is rounded up to a power of two. `prototype` initialises every
+  // slot, so e.g. vectors inside T can be pre-sized.
+  explicit SpscRing(size_t capacity, const T &prototype = T()) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots.assign(size, prototype);
+    mask = size - 1;
+  }
+
+  size_t capacity() const { return slots.size(); }
+
+  // Producer side. Returns the slot to fill, or nullptr when the ring is full.
+  T *beginPush() {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == slots.size()) {
+      return nullptr;
+    }
+    return &slots[h & mask];
+  }
+  void commitPush() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  // Consumer side. Returns the oldest published slot, or nullptr when empty.
+  const T *front() const {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots[t & mask];
+  }
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+private:
+  std::vector<T> slots;
+  size_t mask = 0;
+  // Kept on separate cache lines so producer and consumer don't false-share.
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SUM_SQUARES_H
+#define SUM_SQUARES_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUM_SQUARES_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SUM_SQUARES_NEON 1
+#endif
+
+// Sum-of-squares kernels used for epoch RMS. Every kernel squares in double
+// (a float * float product is exact in double) and accumulates in double, so
+// long epochs don't lose the small samples the way a float accumulator does.
+
+// Reference implementation. The vector kernels are checked against this one.
+inline double sumSquaresScalar(const float *x, size_t n) {
+  double sum = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += static_cast<double>(x[i]) * x[i];
+  }
+  return sum;
+}
+
+#ifdef SUM_SQUARES_X86
+__attribute__((target("sse2"))) inline double sumSquaresSse2(const float *x,
+                                                             size_t n) {
+  __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(x + i);
+    __m128d lo = _mm_cvtps_pd(v);
+    __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+  }
+  acc0 = _mm_add_pd(acc0, acc1);
+  double lanes[2];
+  _mm_storeu_pd(lanes, acc0);
+  return lanes[0] + lanes[1] + sumSquaresScalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) inline double sumSquaresAvx2(const float *x,
+                                                                 size_t n) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256d a = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+    __m256d b = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4));
+    __m256d c = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 8));
+    __m256d d = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 12));
+    acc0 = _mm256_fmadd_pd(a, a, acc0);
+    acc1 = _mm256_fmadd_pd(b, b, acc1);
+    acc2 = _mm256_fmadd_pd(c, c, acc2);
+    acc3 = _mm256_fmadd_pd(d, d, acc3);
+  }
+  for (; i + 4 <= n; i += 4) {
+    __m256d a = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+    acc0 = _mm256_fmadd_pd(a, a, acc0);
+  }
+  __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1),
+                              _mm256_add_pd(acc2, acc3));
+  __m128d half =
+      _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  double lanes[2];
+  _mm_storeu_pd(lanes, half);
+  return lanes[0] + lanes[1] + sumSquaresScalar(x + i, n - i);
+}
+
+__attribute__((target("avx512f"))) inline double
+sumSquaresAvx512(const float *x, size_t n) {
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d a = _mm512_cvtps_pd(_mm256_loadu_ps(x + i));
+    __m512d b = _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 8));
+    acc0 = _mm512_fmadd_pd(a, a, acc0);
+    acc1 = _mm512_fmadd_pd(b, b, acc1);
+  }
+  if (i < n) {
+    // Masked loads zero the lanes past the end, so the tail needs no scalar
+    // loop.
+    const size_t rem = n - i;
+    const __mmask16 mask = static_cast<__mmask16>((1u << rem) - 1);
+    __m512 tail = _mm512_maskz_loadu_ps(mask, x + i);
+    __m512d a = _mm512_cvtps_pd(_mm512_castps512_ps256(tail));
+    __m512d b = _mm512_cvtps_pd(_mm256_castpd_ps(
+        _mm512_extractf64x4_pd(_mm512_castps_pd(tail), 1)));
+    acc0 = _mm512_fmadd_pd(a, a, acc0);
+    acc1 = _mm512_fmadd_pd(b, b, acc1);
+  }
+  return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+#endif
+
+#ifdef SUM_SQUARES_NEON
+inline double sumSquaresNeon(const float *x, size_t n) {
+  float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vld1q_f32(x + i);
+    float64x2_t lo = vcvt_f64_f32(vget_low_f32(v));
+    float64x2_t hi = vcvt_high_f64_f32(v);
+    acc0 = vfmaq_f64(acc0, lo, lo);
+    acc1 = vfmaq_f64(acc1, hi, hi);
+  }
+  return vaddvq_f64(vaddq_f64(acc0, acc1)) + sumSquaresScalar(x + i, n - i);
+}
+#endif
+
+using SumSquaresFn = double (*)(const float *, size_t);
+
+struct SumSquaresKernel {
+  const char *name;
+  SumSquaresFn fn;
+};
+
+// Picks the widest kernel the running CPU supports. Resolved once.
+inline const SumSquaresKernel &sumSquaresKernel() {
+  static const SumSquaresKernel kernel = []() -> SumSquaresKernel {
+#ifdef SUM_SQUARES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return {"avx512", sumSquaresAvx512};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return {"avx2", sumSquaresAvx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      return {"sse2", sumSquaresSse2};
+    }
+#elif defined(SUM_SQUARES_NEON)
+    return {"neon", sumSquaresNeon};
+#endif
+    return {"scalar", sumSquaresScalar};
+  }();
+  return kernel;
+}
+
+inline double sumSquares(const float *x, size_t n) {
+  return sumSquaresKernel().fn(x, n);
+}
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include "pcm_sum_squares.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Streaming RIFF/WAVE reader. Only the header is parsed when the file is
+// opened; sample data is read on demand into a fixed-size look-ahead window, so
+// memory use does not depend on the length of the file.
+class WavReader {
+public:
+  enum class SampleFormat { kPcmInt, kFloat };
+
+  // Number of frames pulled from disk per refill of the look-ahead window.
+  static constexpr size_t kDefaultWindowFrames = 1 << 16;
+
+  WavReader(const std::string &path,
+            size_t lookAheadFrames = kDefaultWindowFrames)
+      : windowFrames(std::max<size_t>(lookAheadFrames, 1)) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cout << "ERROR::WAV_READER::FILE_NOT_OPENED: " << path << std::endl;
+      return;
+    }
+    if (!parseHeader()) {
+      std::cout << "ERROR::WAV_READER::UNSUPPORTED_FILE: " << path
+                << std::endl;
+      ::close(fd);
+      fd = -1;
+      numFrames = 0;
+      return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, dataOffset, dataSize, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+
+  ~WavReader() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  WavReader(const WavReader &) = delete;
+  WavReader &operator=(const WavReader &) = delete;
+
+  bool isOpen() const { return fd >= 0; }
+  int getNumChannels() const { return numChannels; }
+  float getSampleRate() const { return static_cast<float>(sampleRate); }
+  int getBitDepth() const { return bitDepth; }
+  SampleFormat getSampleFormat() const { return format; }
+  size_t getBytesPerFrame() const { return blockAlign; }
+  size_t getNumSamplesPerChannel() const { return numFrames; }
+  double getLengthInSeconds() const {
+    return sampleRate > 0 ? static_cast<double>(numFrames) / sampleRate : 0.0;
+  }
+
+  // Returns a pointer to the interleaved, undecoded bytes of frames
+  // [startFrame, startFrame + count). The pointer stays valid until the next
+  // read call. `count` is clamped to the end of the data chunk and written
+  // back.
+  const uint8_t *readRaw(size_t startFrame, size_t &count) {
+    if (!isOpen() || startFrame >= numFrames) {
+      count = 0;
+      return nullptr;
+    }
+    count = std::min(count, numFrames - startFrame);
+    if (startFrame < windowStart ||
+        startFrame + count > windowStart + windowLen) {
+      fill(startFrame, std::max(count, windowFrames));
+    }
+    return window.data() + (startFrame - windowStart) * blockAlign;
+  }
+
+  // Decodes frames [startFrame, startFrame + count) into one float buffer per
+  // channel, scaled to [-1, 1). Only channels [firstChannel, endChannel) are
+  // decoded (all of them by default); `out` is still sized to every channel.
+  // Returns the number of frames decoded.
+  size_t readPlanar(size_t startFrame, size_t count,
+                    std::vector<std::vector<float>> &out, int firstChannel = 0,
+                    int endChannel = -1) {
+    if (endChannel < 0 || endChannel > numChannels) {
+      endChannel = numChannels;
+    }
+    const uint8_t *bytes = readRaw(startFrame, count);
+    out.resize(numChannels);
+    for (int ch = firstChannel; ch < endChannel; ++ch) {
+      out[ch].resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t *frame = bytes + i * blockAlign;
+      for (int ch = firstChannel; ch < endChannel; ++ch) {
+        out[ch][i] = decodeSample(frame + ch * bytesPerSample);
+      }
+    }
+    return count;
+  }
+
+  // Decodes frames [startFrame, startFrame + count) as interleaved floats,
+  // `stride` (>= getNumChannels()) values per frame with the padding zeroed.
+  // Returns the number of frames decoded.
+  size_t readInterleaved(size_t startFrame, size_t count,
+                         std::vector<float> &out, size_t stride) {
+    const uint8_t *bytes = readRaw(startFrame, count);
+    out.assign(count * stride, 0.f);
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t *frame = bytes + i * blockAlign;
+      for (int ch = 0; ch < numChannels; ++ch) {
+        out[i * stride + ch] = decodeSample(frame + ch * bytesPerSample);
+      }
+    }
+    return count;
+  }
+
+  // Sets sums[ch] to channel ch's sum of squares over frames
+  // [startFrame, startFrame + count), in the same full-scale units as
+  // readPlanar(), straight from the file bytes: integer PCM up to 24 bits is
+  // squared and summed exactly in integers, int32 and floats in double.
+  // `sums` must hold getNumChannels() values. Returns the number of frames
+  // summed.
+  size_t readSumSquares(size_t startFrame, size_t count, double *sums) {
+    std::fill(sums, sums + numChannels, 0.0);
+    if (format == SampleFormat::kFloat || bitDepth == 32) {
+      return readWideSumSquares(startFrame, count, sums);
+    }
+    // An int24 square is below 2^46, so an int64 holds 2^17 of them; chunks
+    // of 2^16 samples leave room for the vector kernels' lane totals.
+    const size_t chunkFrames =
+        std::max<size_t>(1, (size_t(1) << 16) / numChannels);
+    const double fullScale = 1.0 / (1 << (bitDepth - 1));
+    const double scale = fullScale * fullScale;
+    intSums.resize(numChannels);
+    size_t done = 0;
+    while (done < count) {
+      size_t n = std::min(chunkFrames, count - done);
+      const uint8_t *bytes = readRaw(startFrame + done, n);
+      if (n == 0) {
+        break;
+      }
+      std::fill(intSums.begin(), intSums.end(), 0);
+      if (bitDepth == 16) {
+        pcmInt16Kernel().fn(bytes, n, numChannels, blockAlign, intSums.data());
+      } else if (bitDepth == 24) {
+        pcmInt24Kernel().fn(bytes, n, numChannels, blockAlign, intSums.data());
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          for (int ch = 0; ch < numChannels; ++ch) {
+            const int64_t s = int(bytes[i * blockAlign + ch]) - 128;
+            intSums[ch] += s * s;
+          }
+        }
+      }
+      for (int ch = 0; ch < numChannels; ++ch) {
+        sums[ch] += static_cast<double>(intSums[ch]) * scale;
+      }
+      done += n;
+    }
+    return done;
+  }
+
+private:
+  // readSumSquares() for the formats whose squares an int64 can't sum: int32
+  // through the double PCM kernel, packed float32 one channel at a time
+  // through sumSquares(). float64 and padded float32 frames are decoded.
+  size_t readWideSumSquares(size_t startFrame, size_t count, double *sums) {
+    const size_t chunkFrames =
+        std::max<size_t>(1, (size_t(1) << 16) / numChannels);
+    const bool isInt = format == SampleFormat::kPcmInt;
+    const bool packedFloat = !isInt && bitDepth == 32 &&
+                             blockAlign == 4 * size_t(numChannels);
+    size_t done = 0;
+    while (done < count) {
+      size_t n = std::min(chunkFrames, count - done);
+      const uint8_t *bytes = readRaw(startFrame + done, n);
+      if (n == 0) {
+        break;
+      }
+      if (isInt) {
+        pcmInt32Kernel().fn(bytes, n, numChannels, blockAlign, sums);
+      } else if (packedFloat) {
+        floatPlane.resize(n);
+        for (int ch = 0; ch < numChannels; ++ch) {
+          if (numChannels == 1) {
+            std::memcpy(floatPlane.data(), bytes, n * sizeof(float));
+          } else {
+            for (size_t i = 0; i < n; ++i) {
+              std::memcpy(&floatPlane[i], bytes + (i * numChannels + ch) * 4,
+                          sizeof(float));
+            }
+          }
+          sums[ch] += sumSquares(floatPlane.data(), n);
+        }
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          const uint8_t *frame = bytes + i * blockAlign;
+          for (int ch = 0; ch < numChannels; ++ch) {
+            const double s = decodeSample(frame + ch * bytesPerSample);
+            sums[ch] += s * s;
+          }
+        }
+      }
+      done += n;
+    }
+    if (isInt) {
+      // The kernel sums native units; 2^-62 scales them exactly.
+      const double scale = std::ldexp(1.0, -62);
+      for (int ch = 0; ch < numChannels; ++ch) {
+        sums[ch] *= scale;
+      }
+    }
+    return done;
+  }
+
+  static uint16_t readU16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+  static uint32_t readU32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+  }
+
+  bool readAt(void *dst, size_t len, off_t offset) const {
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    while (len > 0) {
+      ssize_t got = ::pread(fd, out, len, offset);
+      if (got <= 0) {
+        return false;
+      }
+      out += got;
+      len -= got;
+      offset += got;
+    }
+    return true;
+  }
+
+  // Walks the RIFF chunk list looking for "fmt " and "data". Everything else
+  // (LIST, bext, fact, ...) is skipped without being read.
+  bool parseHeader() {
+    uint8_t riff[12];
+    if (!readAt(riff, sizeof(riff), 0) || std::memcmp(riff, "RIFF", 4) != 0 ||
+        std::memcmp(riff + 8, "WAVE", 4) != 0) {
+      return false;
+    }
+    bool haveFmt = false;
+    off_t offset = sizeof(riff);
+    uint8_t chunk[8];
+    while (readAt(chunk, sizeof(chunk), offset)) {
+      const uint32_t chunkSize = readU32(chunk + 4);
+      const off_t body = offset + sizeof(chunk);
+      if (std::memcmp(chunk, "fmt ", 4) == 0) {
+        uint8_t fmt[40] = {};
+        if (chunkSize < 16 ||
+            !readAt(fmt, std::min<size_t>(chunkSize, sizeof(fmt)), body)) {
+          return false;
+        }
+        uint16_t tag = readU16(fmt);
+        numChannels = readU16(fmt + 2);
+        sampleRate = readU32(fmt + 4);
+        blockAlign = readU16(fmt + 12);
+        bitDepth = readU16(fmt + 14);
+        // WAVE_FORMAT_EXTENSIBLE keeps the real format tag in the sub-format
+        // GUID.
+        if (tag == 0xFFFE && chunkSize >= 26) {
+          tag = readU16(fmt + 24);
+        }
+        if (tag == 1) {
+          format = SampleFormat::kPcmInt;
+        } else if (tag == 3) {
+          format = SampleFormat::kFloat;
+        } else {
+          return false;
+        }
+        haveFmt = true;
+      } else if (std::memcmp(chunk, "data", 4) == 0) {
+        if (!haveFmt) {
+          return false;
+        }
+        dataOffset = body;
+        dataSize = chunkSize;
+        break;
+      }
+      // Chunks are padded to an even number of bytes.
+      offset = body + chunkSize + (chunkSize & 1);
+    }
+    if (!haveFmt || dataOffset == 0 || numChannels <= 0 || sampleRate == 0) {
+      return false;
+    }
+    bytesPerSample = bitDepth / 8;
+    const bool validDepth =
+        format == SampleFormat::kFloat
+            ? (bitDepth == 32 || bitDepth == 64)
+            : (bitDepth == 8 || bitDepth == 16 || bitDepth == 24 ||
+               bitDepth == 32);
+    if (!validDepth ||
+        blockAlign < static_cast<size_t>(numChannels * bytesPerSample)) {
+      return false;
+    }
+    // Files written by streaming encoders may leave the size unset or larger
+    // than what was actually written, so trust the file length instead.
+    const off_t fileSize = ::lseek(fd, 0, SEEK_END);
+    if (fileSize > dataOffset &&
+        dataSize > static_cast<uint64_t>(fileSize - dataOffset)) {
+      dataSize = fileSize - dataOffset;
+    }
+    numFrames = dataSize / blockAlign;
+    return true;
+  }
+
+  // Replaces the look-ahead window with up to `count` frames from startFrame.
+  void fill(size_t startFrame, size_t count) {
+    count = std::min(count, numFrames - startFrame);
+    window.resize(count * blockAlign);
+    if (!readAt(window.data(), window.size(),
+                dataOffset + static_cast<off_t>(startFrame * blockAlign))) {
+      std::fill(window.begin(), window.end(), 0);
+    }
+    windowStart = startFrame;
+    windowLen = count;
+  }
+
+  float decodeSample(const uint8_t *p) const {
+    if (format == SampleFormat::kFloat) {
+      if (bitDepth == 64) {
+        double d;
+        std::memcpy(&d, p, sizeof(d));
+        return static_cast<float>(d);
+      }
+      float f;
+      std::memcpy(&f, p, sizeof(f));
+      return f;
+    }
+    switch (bitDepth) {
+    case 8:
+      return (static_cast<int>(p[0]) - 128) / 128.f;
+    case 16:
+      return static_cast<int16_t>(readU16(p)) / 32768.f;
+    case 24: {
+      // Assemble in the top of an int32 so the shift back sign-extends.
+      int32_t s = static_cast<int32_t>((uint32_t(p[0]) << 8) |
+                                       (uint32_t(p[1]) << 16) |
+                                       (uint32_t(p[2]) << 24)) >>
+                  8;
+      return s / 8388608.f;
+    }
+    default:
+      return static_cast<int32_t>(readU32(p)) / 2147483648.f;
+    }
+  }
+
+  int fd = -1;
+  int numChannels = 0;
+  uint32_t sampleRate = 0;
+  int bitDepth = 0;
+  int bytesPerSample = 0;
+  size_t blockAlign = 0;
+  SampleFormat format = SampleFormat::kPcmInt;
+  off_t dataOffset = 0;
+  uint64_t dataSize = 0;
+  size_t numFrames = 0;
+
+  const size_t windowFrames;
+  std::vector<uint8_t> window;
+  size_t windowStart = 0;
+  size_t windowLen = 0;
+  // Per-channel integer sums and one channel's float32 samples for
+  // readSumSquares(), reused between calls.
+  std::vector<int64_t> intSums;
+  std::vector<float> floatPlane;
+};
+
+#endif
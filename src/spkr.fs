@@ -0,0 +1,11 @@
+#version 330 core
+in float v_level;
+
+out vec4 FragColor;
+
+uniform vec3 lightColour; // Colour of a speaker at full level
+uniform vec3 idleColour;  // Colour of a silent speaker
+
+void main() {
+    FragColor = vec4(mix(idleColour, lightColour, clamp(v_level, 0.0, 1.0)), 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// Speaker markers: one shared quad drawn once per speaker, placed by the
+// per-instance attributes (SpeakerInstance in speaker_markers.hpp).
+layout(location = 0) in vec3 a_position;      // Quad corner, unit size, facing +z
+layout(location = 1) in vec4 a_positionScale; // xyz: marker centre, w: edge length
+layout(location = 2) in vec4 a_orientation;   // Quaternion (x, y, z, w)
+layout(location = 3) in float a_level;        // 0..1
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out float v_level;
+
+// Rotates v by the unit quaternion q.
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+    vec3 worldPos = a_positionScale.xyz + rotate(a_orientation, a_position * a_positionScale.w);
+    v_level = a_level;
+    gl_Position = projection * view * model * vec4(worldPos, 1.0);
+}
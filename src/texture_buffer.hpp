@@ -0,0 +1,62 @@
+#ifndef TEXTURE_BUFFER_H
+#define TEXTURE_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// A buffer object exposed to shaders as a samplerBuffer, for per-vertex or
+// tabulated data too large for uniforms. Like UniformBuffer it is destroyed
+// explicitly while the context is current.
+class TextureBuffer {
+public:
+  explicit TextureBuffer(GLenum internalFormat)
+      : kInternalFormat(internalFormat) {
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+  }
+  void destroy() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+    texture = buffer = 0;
+  }
+
+  TextureBuffer(const TextureBuffer &) = delete;
+  TextureBuffer &operator=(const TextureBuffer &) = delete;
+
+  // Replaces the whole contents.
+  void upload(const void *data, size_t bytes, GLenum usage = GL_STATIC_DRAW) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, data, usage);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, kInternalFormat, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+
+  // Overwrites `bytes` at `offset` of the storage upload() allocated.
+  void update(size_t offset, const void *data, size_t bytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+  void bind(GLuint unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+  }
+
+  // Largest texel count a texture buffer may have on this context.
+  static GLint maxTexels() {
+    GLint texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+    return texels;
+  }
+
+private:
+  const GLenum kInternalFormat;
+  GLuint buffer = 0;
+  GLuint texture = 0;
+};
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "speaker_points/envelope_cache.hpp"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// An RGBA8 image with its full mip chain, level 0 first, rows bottom-up as
+// glTexImage2D expects. The pixels either live in memory (just decoded) or in
+// a read-only mapping of the image's ".mips" sidecar.
+//
+// Sidecar layout (native endianness):
+//   MipChainHeader
+//   numLevels MipLevel entries
+//   pixel data, each level at its MipLevel::offset from the start of the file
+// Like the envelope sidecar it is keyed by the source's size and mtime, with
+// a content hash as the fallback for a touched but unchanged file. The level
+// table and pixels carry a hash of their own, checked on every map, so a
+// damaged chain is decoded again rather than uploaded.
+struct MipLevel {
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset;
+};
+
+struct MipChainHeader {
+  char magic[8];
+  uint32_t headerSize;
+  uint32_t numLevels;
+  uint64_t contentHash;
+  uint64_t fileSize;
+  int64_t fileMtime;
+  // hashBuffer() of everything after the header.
+  uint64_t payloadHash;
+};
+
+class MipChain {
+public:
+  static constexpr char kMagic[8] = {'S', 'A', 'M', 'I', 'P', '0', '0', '2'};
+
+  static std::string sidecarPath(const std::string &imagePath) {
+    return imagePath + ".mips";
+  }
+
+  MipChain() = default;
+  ~MipChain() { unmap(); }
+  MipChain(const MipChain &) = delete;
+  MipChain &operator=(const MipChain &) = delete;
+
+  // The sidecar if it matches the image, else a fresh decode (which then
+  // writes the sidecar for next time). Returns false if the image can't be
+  // decoded. Runs on a worker thread.
+  bool load(const std::string &imagePath) {
+    if (openSidecar(imagePath)) {
+      return true;
+    }
+    if (!decode(imagePath)) {
+      return false;
+    }
+    writeSidecar(imagePath);
+    return true;
+  }
+
+  bool isMapped() const { return mapping != nullptr; }
+  size_t getNumLevels() const { return levels.size(); }
+  const MipLevel &getLevel(size_t i) const { return levels[i]; }
+  const uint8_t *getPixels(size_t i) const { return data + levels[i].offset; }
+  static size_t levelBytes(const MipLevel &level) {
+    return static_cast<size_t>(level.width) * level.height * 4;
+  }
+
+private:
+  bool openSidecar(const std::string &imagePath) {
+    struct stat imageStat;
+    if (::stat(imagePath.c_str(), &imageStat) != 0) {
+      return false;
+    }
+    int fd = ::open(sidecarPath(imagePath).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(MipChainHeader)) {
+      ::close(fd);
+      return false;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+    mapping = addr;
+    mappingSize = st.st_size;
+
+    const auto &h = *static_cast<const MipChainHeader *>(mapping);
+    const size_t tableEnd =
+        sizeof(MipChainHeader) + h.numLevels * sizeof(MipLevel);
+    bool valid = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 &&
+                 h.headerSize == sizeof(MipChainHeader) && h.numLevels > 0 &&
+                 h.numLevels <= 32 && tableEnd <= mappingSize &&
+                 h.fileSize == static_cast<uint64_t>(imageStat.st_size);
+    if (valid) {
+      const auto *table = reinterpret_cast<const MipLevel *>(
+          static_cast<const char *>(mapping) + sizeof(MipChainHeader));
+      levels.assign(table, table + h.numLevels);
+      for (const MipLevel &level : levels) {
+        valid = valid && level.offset >= tableEnd &&
+                level.offset + levelBytes(level) <= mappingSize;
+      }
+    }
+    if (valid && h.fileMtime != static_cast<int64_t>(imageStat.st_mtime)) {
+      valid = h.contentHash == hashFileContents(imagePath);
+    }
+    valid = valid &&
+            h.payloadHash ==
+                hashBuffer(static_cast<const char *>(mapping) +
+                               sizeof(MipChainHeader),
+                           mappingSize - sizeof(MipChainHeader));
+    if (!valid) {
+      unmap();
+      levels.clear();
+      return false;
+    }
+    data = static_cast<const uint8_t *>(mapping);
+    return true;
+  }
+
+  // Decodes to RGBA8, flips to bottom-up and box-filters every level down to
+  // 1x1. Offsets are laid out as in the sidecar so writing it is one block.
+  bool decode(const std::string &imagePath) {
+    int width = 0, height = 0, channels = 0;
+    stbi_uc *image = stbi_load(imagePath.c_str(), &width, &height, &channels,
+                               STBI_rgb_alpha);
+    if (image == nullptr) {
+      return false;
+    }
+    uint32_t w = width, h = height;
+    size_t offset = 0;
+    for (;;) {
+      levels.push_back({w, h, 0});
+      if (w == 1 && h == 1) {
+        break;
+      }
+      w = std::max(1u, w / 2);
+      h = std::max(1u, h / 2);
+    }
+    offset = sizeof(MipChainHeader) + levels.size() * sizeof(MipLevel);
+    for (MipLevel &level : levels) {
+      level.offset = offset;
+      offset += levelBytes(level);
+    }
+    owned.resize(offset);
+
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    uint8_t *base = owned.data() + levels[0].offset;
+    for (int y = 0; y < height; ++y) {
+      std::memcpy(base + (height - 1 - y) * rowBytes, image + y * rowBytes,
+                  rowBytes);
+    }
+    stbi_image_free(image);
+
+    for (size_t i = 1; i < levels.size(); ++i) {
+      downsample(levels[i - 1], owned.data() + levels[i - 1].offset,
+                 levels[i], owned.data() + levels[i].offset);
+    }
+    data = owned.data();
+    return true;
+  }
+
+  // 2x2 box filter; the last row / column is repeated for odd sizes.
+  static void downsample(const MipLevel &src, const uint8_t *srcPixels,
+                         const MipLevel &dst, uint8_t *dstPixels) {
+    for (uint32_t y = 0; y < dst.height; ++y) {
+      const uint32_t y0 = std::min(2 * y, src.height - 1);
+      const uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+      for (uint32_t x = 0; x < dst.width; ++x) {
+        const uint32_t x0 = std::min(2 * x, src.width - 1);
+        const uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+        const uint8_t *p00 = srcPixels + (y0 * src.width + x0) * 4;
+        const uint8_t *p01 = srcPixels + (y0 * src.width + x1) * 4;
+        const uint8_t *p10 = srcPixels + (y1 * src.width + x0) * 4;
+        const uint8_t *p11 = srcPixels + (y1 * src.width + x1) * 4;
+        uint8_t *out = dstPixels + (y * dst.width + x) * 4;
+        for (int c = 0; c < 4; ++c) {
+          out[c] = static_cast<uint8_t>(
+              (p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+        }
+      }
+    }
+  }
+
+  // Written through replaceFile(), so a reader never maps a half-written
+  // chain. Failure (e.g. a read-only resource directory) is not an error; the
+  // next run just decodes again.
+  bool writeSidecar(const std::string &imagePath) {
+    struct stat imageStat;
+    if (::stat(imagePath.c_str(), &imageStat) != 0) {
+      return false;
+    }
+    std::memcpy(owned.data() + sizeof(MipChainHeader), levels.data(),
+                levels.size() * sizeof(MipLevel));
+    MipChainHeader h = {};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.headerSize = sizeof(MipChainHeader);
+    h.numLevels = static_cast<uint32_t>(levels.size());
+    h.contentHash = hashFileContents(imagePath);
+    h.fileSize = imageStat.st_size;
+    h.fileMtime = imageStat.st_mtime;
+    h.payloadHash = hashBuffer(owned.data() + sizeof(MipChainHeader),
+                               owned.size() - sizeof(MipChainHeader));
+    std::memcpy(owned.data(), &h, sizeof(h));
+
+    return replaceFile(sidecarPath(imagePath), [this](FILE *f) {
+      return std::fwrite(owned.data(), 1, owned.size(), f) == owned.size();
+    });
+  }
+
+  void unmap() {
+    if (mapping != nullptr) {
+      ::munmap(mapping, mappingSize);
+      mapping = nullptr;
+      mappingSize = 0;
+    }
+  }
+
+  std::vector<MipLevel> levels;
+  const uint8_t *data = nullptr;
+  std::vector<uint8_t> owned;
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+};
+
+#endif
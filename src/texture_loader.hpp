@@ -0,0 +1,227 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "texture_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads image textures without stalling the render thread. Worker threads
+// decode each image and build its mip chain (or map it from the ".mips"
+// sidecar, see MipChain); the render thread calls update() once per frame to
+// upload at most a byte budget of finished chains through a pixel unpack
+// buffer.
+//
+// Levels go up coarsest first and GL_TEXTURE_BASE_LEVEL follows them down, so
+// a texture is drawable (blurry) after its first, tiny upload and sharpens
+// over the next frames. The PBO is orphaned before every chunk, so filling it
+// never waits on the previous chunk's copy.
+class TextureLoader {
+public:
+  static constexpr size_t kDefaultUploadBudget = 4 << 20;
+
+  // Starts decoding `paths` right away. numThreads 0 uses one thread per
+  // image, up to the hardware thread count. Needs a current context.
+  explicit TextureLoader(std::vector<std::string> paths,
+                         unsigned numThreads = 0)
+      : kPaths(std::move(paths)), textures(kPaths.size()) {
+    glGenBuffers(1, &pbo);
+    if (numThreads == 0) {
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min<unsigned>(numThreads, kPaths.size());
+    for (unsigned i = 0; i < numThreads; ++i) {
+      workers.emplace_back([this] { run(); });
+    }
+  }
+
+  ~TextureLoader() { joinWorkers(); }
+
+  // Must run while the GL context is still current.
+  void destroy() {
+    joinWorkers();
+    for (Texture &t : textures) {
+      glDeleteTextures(1, &t.texture);
+      t.texture = 0;
+    }
+    glDeleteBuffers(1, &pbo);
+    pbo = 0;
+  }
+
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+
+  size_t size() const { return textures.size(); }
+  // At least one mip level is resident, so getTexture(i) can be sampled.
+  bool isReady(size_t i) const { return textures[i].drawable; }
+  GLuint getTexture(size_t i) const { return textures[i].texture; }
+  // Every texture is fully resident or failed to decode.
+  bool isDone() const { return numDone == textures.size(); }
+
+  // Uploads up to `budgetBytes` of decoded levels (always at least one row,
+  // so a tiny budget still makes progress). Render thread only.
+  void update(size_t budgetBytes = kDefaultUploadBudget) {
+    for (size_t i = 0; i < textures.size() && budgetBytes > 0; ++i) {
+      Texture &t = textures[i];
+      if (t.finished || t.state.load(std::memory_order_acquire) == Pending) {
+        continue;
+      }
+      if (t.state.load(std::memory_order_relaxed) == Failed) {
+        std::cout << "ERROR::TEXTURE::LOAD_FAILED: " << kPaths[i] << std::endl;
+        retire(t);
+        continue;
+      }
+      if (t.texture == 0) {
+        allocate(t);
+      }
+      budgetBytes -= uploadRows(t, budgetBytes);
+    }
+  }
+
+  // Blocks until every texture is fully resident, for renderers that must
+  // not show a partly loaded frame (headless).
+  void finish() {
+    while (!isDone()) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        decoded.wait(lock, [this] {
+          for (const Texture &t : textures) {
+            if (!t.finished && t.state.load() != Pending) {
+              return true;
+            }
+          }
+          return false;
+        });
+      }
+      update(SIZE_MAX);
+    }
+  }
+
+private:
+  enum State { Pending, Decoded, Failed };
+
+  struct Texture {
+    std::unique_ptr<MipChain> chain;
+    std::atomic<int> state{Pending};
+    GLuint texture = 0;
+    // Next level / row to upload, counting levels down from the coarsest.
+    size_t level = 0;
+    uint32_t row = 0;
+    bool drawable = false;
+    bool finished = false;
+  };
+
+  void run() {
+    for (size_t i = nextJob.fetch_add(1); i < textures.size();
+         i = nextJob.fetch_add(1)) {
+      auto chain = std::make_unique<MipChain>();
+      const bool ok = chain->load(kPaths[i]);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        textures[i].chain = std::move(chain);
+        textures[i].state.store(ok ? Decoded : Failed,
+                                std::memory_order_release);
+      }
+      decoded.notify_all();
+    }
+  }
+
+  void joinWorkers() {
+    for (std::thread &t : workers) {
+      t.join();
+    }
+    workers.clear();
+  }
+
+  // Storage for every level up front; sampling is limited to the uploaded
+  // ones through the base level.
+  void allocate(Texture &t) {
+    const MipChain &chain = *t.chain;
+    glGenTextures(1, &t.texture);
+    glBindTexture(GL_TEXTURE_2D, t.texture);
+    for (size_t l = 0; l < chain.getNumLevels(); ++l) {
+      const MipLevel &level = chain.getLevel(l);
+      glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, level.width, level.height, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    chain.getNumLevels() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    t.level = chain.getNumLevels() - 1;
+    t.row = 0;
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  // Uploads whole rows of the current level, returning the bytes used.
+  size_t uploadRows(Texture &t, size_t budgetBytes) {
+    const MipChain &chain = *t.chain;
+    const MipLevel &level = chain.getLevel(t.level);
+    const size_t rowBytes = static_cast<size_t>(level.width) * 4;
+    const uint32_t rows = static_cast<uint32_t>(std::clamp<size_t>(
+        budgetBytes / rowBytes, 1, level.height - t.row));
+    const size_t bytes = rows * rowBytes;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    void *staging = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (staging != nullptr) {
+      std::memcpy(staging, chain.getPixels(t.level) + t.row * rowBytes, bytes);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindTexture(GL_TEXTURE_2D, t.texture);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glTexSubImage2D(GL_TEXTURE_2D, t.level, 0, t.row, level.width, rows,
+                      GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    t.row += rows;
+    if (t.row == level.height) {
+      // Level complete: let the sampler reach it.
+      glBindTexture(GL_TEXTURE_2D, t.texture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, t.level);
+      t.drawable = true;
+      t.row = 0;
+      if (t.level == 0) {
+        retire(t);
+      } else {
+        --t.level;
+      }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return std::min(bytes, budgetBytes);
+  }
+
+  // Fully uploaded (or failed): the decoded pixels / mapping can go.
+  void retire(Texture &t) {
+    t.finished = true;
+    t.chain.reset();
+    ++numDone;
+  }
+
+  const std::vector<std::string> kPaths;
+  std::vector<Texture> textures;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> nextJob{0};
+  std::mutex mutex;
+  std::condition_variable decoded;
+  size_t numDone = 0;
+  GLuint pbo = 0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// CPU copy of a std140 uniform block plus the buffer object backing it. Writes
+// go through edit(), which marks the copy dirty; flush() uploads it in one
+// glBufferSubData and only if something changed.
+template <typename T> class UniformBuffer {
+public:
+  explicit UniformBuffer(GLuint bindingPoint) : kBindingPoint(bindingPoint) {
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kBindingPoint, ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  // Must run while the GL context is still current, so it is explicit rather
+  // than a destructor.
+  void destroy() {
+    glDeleteBuffers(1, &ID);
+    ID = 0;
+  }
+
+  UniformBuffer(const UniformBuffer &) = delete;
+  UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+  GLuint getBindingPoint() const { return kBindingPoint; }
+  const T &get() const { return data; }
+  T &edit() {
+    dirty = true;
+    return data;
+  }
+
+  void flush() {
+    if (!dirty) {
+      return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    dirty = false;
+  }
+
+private:
+  const GLuint kBindingPoint;
+  GLuint ID = 0;
+  T data{};
+  bool dirty = true;
+};
+
+// Mirrors the std140 FrameParams block declared in room.vs and room.fs. Every
+// member is a vec4 or a 4-byte scalar so the C++ and GLSL layouts agree
+// without padding fields. The per-speaker levels live in a texture buffer
+// (LevelHistory), sized by the speaker layout.
+struct FrameUniforms {
+  glm::vec4 lightDir;
+  glm::vec4 lightColor;
+  glm::vec4 ambientColor;
+  glm::vec4 baseColor;
+  glm::vec4 wavePeakColor;
+  float time;
+  float waveColorScale;
+  float waveColorOffset;
+  float baseSpatialFrequency;
+  float amplitudeFrequencyScale;
+  float maxOverallDisplacement;
+  float spatialDecayRate;
+  int useBands;
+  float epochPeriod;
+  int historyFirst;
+  int historyLast;
+  int pad;
+};
+static_assert(sizeof(FrameUniforms) == 16 * 5 + 4 * 12,
+              "FrameUniforms must match the std140 FrameParams block");
+
+// Mirrors the std140 Views block in room.vs, room_cpu.vs and walls.vs: one
+// camera per instance of a multi-view draw. Each view's projection * view
+// matrix, and the tile of the framebuffer it lands in as an NDC scale (xy)
+// and offset (zw). See RoomViews.
+constexpr int kMaxViews = 4;
+struct ViewUniforms {
+  glm::mat4 viewProjection[kMaxViews];
+  glm::vec4 tile[kMaxViews];
+};
+static_assert(sizeof(ViewUniforms) == kMaxViews * (64 + 16),
+              "ViewUniforms must match the std140 Views block");
+
+#endif
@@ -0,0 +1,10 @@
+#version 330 core
+in vec2 v_texCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D u_wallTexture;
+
+void main() {
+    FragColor = vec4(texture(u_wallTexture, v_texCoord).rgb, 1.0);
+}
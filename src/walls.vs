@@ -0,0 +1,31 @@
+#version 330 core
+// Textured room walls behind the sphere (krear_room in room_vertices.hpp).
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec2 a_texCoord;
+
+uniform mat4 u_model;
+// The camera of each instance (ViewUniforms in uniform_buffer.hpp): a
+// multi-view draw has one instance per view.
+#define MAX_VIEWS 4
+layout(std140) uniform Views {
+    mat4 u_viewProjection[MAX_VIEWS];
+    vec4 u_viewTile[MAX_VIEWS]; // xy: NDC scale, zw: NDC offset of the view's tile
+};
+
+// Moves a clip-space position of this instance's view into its tile, clipping
+// against the tile's edges so nothing spills into a neighbour.
+vec4 toTile(vec4 clip) {
+    vec4 tile = u_viewTile[gl_InstanceID];
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+    return vec4(clip.xy * tile.xy + tile.zw * clip.w, clip.zw);
+}
+
+out vec2 v_texCoord;
+
+void main() {
+    v_texCoord = a_texCoord;
+    gl_Position = toTile(u_viewProjection[gl_InstanceID] * u_model * vec4(a_position, 1.0));
+}
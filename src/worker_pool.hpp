@@ -0,0 +1,121 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent threads for per-frame data-parallel work. parallelFor() hands out
+// task indices from an atomic counter, the calling thread works alongside the
+// pool, and nothing is allocated per call, so it is cheap enough to run every
+// frame.
+class WorkerPool {
+public:
+  // numThreads counts the calling thread; 0 uses every hardware thread.
+  explicit WorkerPool(unsigned numThreads = 0) {
+    if (numThreads == 0) {
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < numThreads; ++i) {
+      workers.emplace_back([this] { run(); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned getNumThreads() const { return workers.size() + 1; }
+
+  // Calls fn(task) for every task in [0, numTasks) and returns once all of
+  // them have finished. Not reentrant.
+  template <typename Fn> void parallelFor(size_t numTasks, Fn &&fn) {
+    if (workers.empty() || numTasks <= 1) {
+      for (size_t task = 0; task < numTasks; ++task) {
+        fn(task);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = const_cast<void *>(static_cast<const void *>(&fn));
+      invoke = [](void *f, size_t task) {
+        (*static_cast<std::remove_reference_t<Fn> *>(f))(task);
+      };
+      jobTasks = numTasks;
+      nextTask.store(0, std::memory_order_relaxed);
+      busyWorkers = workers.size();
+      ++generation;
+    }
+    wake.notify_all();
+    drain(job, invoke, numTasks);
+    // Every worker checks in before returning, so `fn` outlives its use.
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+  }
+
+private:
+  using InvokeFn = void (*)(void *, size_t);
+
+  void drain(void *fn, InvokeFn call, size_t numTasks) {
+    for (size_t task = nextTask.fetch_add(1, std::memory_order_relaxed);
+         task < numTasks;
+         task = nextTask.fetch_add(1, std::memory_order_relaxed)) {
+      call(fn, task);
+    }
+  }
+
+  void run() {
+    uint64_t seen = 0;
+    while (true) {
+      void *fn;
+      InvokeFn call;
+      size_t numTasks;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+          return;
+        }
+        seen = generation;
+        fn = job;
+        call = invoke;
+        numTasks = jobTasks;
+      }
+      drain(fn, call, numTasks);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--busyWorkers == 0) {
+        done.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping = false;
+  uint64_t generation = 0;
+  void *job = nullptr;
+  InvokeFn invoke = nullptr;
+  size_t jobTasks = 0;
+  size_t busyWorkers = 0;
+  std::atomic<size_t> nextTask{0};
+};
+
+#endif